@@ -0,0 +1,135 @@
+//---------------------------
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+
+#include "../src/Map.hpp"
+#include "../src/BalancedMap.hpp"
+
+//---------------------------
+
+// Balancing policies of BalancedMap (and Map for reference) on three workloads:
+//   insert-heavy  80% add / 20% remove of random keys, starting empty
+//   lookup-heavy  n random adds, then 4n uniform gets
+//   skewed        n random adds, then 4n gets of which 90% hit 1% of the keys
+// Usage: bench_balance_policies [n ...]   (default: 100000 1000000)
+
+//---------------------------
+
+typedef std::chrono::steady_clock Clock;
+
+//---------------------------
+
+static double mops(Clock::time_point from, Clock::time_point to, size_t ops) {
+    return static_cast<double>(ops) / std::chrono::duration<double>(to - from).count() * 1e-6;
+}
+
+//---------------------------
+
+struct Workload {
+    std::vector<int> keys;     // shuffled, used to fill the map
+    std::vector<int> writes;   // insert-heavy stream, negative values are removals
+    std::vector<int> uniform;  // lookup-heavy queries
+    std::vector<int> skewed;   // skewed queries
+};
+
+//---------------------------
+
+template <class TMap>
+static void run(const char* name, const Workload& work) {
+
+    size_t found = 0;
+    double insertHeavy, lookupHeavy, skewed;
+
+    {
+        TMap map;
+
+        Clock::time_point t0 = Clock::now();
+        for(size_t i = 0; i < work.writes.size(); ++i) {
+            if(work.writes[i] >= 0)
+                map.add(work.writes[i], 'a' + (work.writes[i] & 15));
+            else
+                map.remove(~work.writes[i]);
+        }
+
+        insertHeavy = mops(t0, Clock::now(), work.writes.size());
+    }
+
+    {
+        TMap map;
+        for(size_t i = 0; i < work.keys.size(); ++i)
+            map.add(work.keys[i], 'a' + (work.keys[i] & 15));
+
+        Clock::time_point t0 = Clock::now();
+        for(size_t i = 0; i < work.uniform.size(); ++i)
+            found += map.get(work.uniform[i]) != nullptr;
+
+        Clock::time_point t1 = Clock::now();
+        for(size_t i = 0; i < work.skewed.size(); ++i)
+            found += map.get(work.skewed[i]) != nullptr;
+
+        Clock::time_point t2 = Clock::now();
+
+        lookupHeavy = mops(t0, t1, work.uniform.size());
+        skewed = mops(t1, t2, work.skewed.size());
+    }
+
+    std::cout << "  " << std::left << std::setw(16) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(10) << insertHeavy
+              << std::setw(10) << lookupHeavy
+              << std::setw(10) << skewed
+              << "   (hits " << found << ")\n";
+}
+
+//---------------------------
+
+int main(int argc, char** argv) {
+
+    std::vector<size_t> sizes;
+    for(int i = 1; i < argc; ++i)
+        sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+
+    if(sizes.empty())
+        sizes = { 100000, 1000000 };
+
+    std::mt19937 rng(42);
+
+    for(size_t s = 0; s < sizes.size(); ++s) {
+
+        size_t n = sizes[s];
+        Workload work;
+
+        work.keys.resize(n);
+        for(size_t i = 0; i < n; ++i)
+            work.keys[i] = static_cast<int>(i);
+
+        std::shuffle(work.keys.begin(), work.keys.end(), rng);
+
+        for(size_t i = 0; i < 2 * n; ++i) {
+            int key = static_cast<int>(rng() % n);
+            work.writes.push_back(rng() % 5 == 0 ? ~key : key);
+        }
+
+        for(size_t i = 0; i < 4 * n; ++i)
+            work.uniform.push_back(static_cast<int>(rng() % n));
+
+        size_t hot = n / 100 > 0 ? n / 100 : 1;
+        for(size_t i = 0; i < 4 * n; ++i)
+            work.skewed.push_back(rng() % 10 != 0 ? work.keys[rng() % hot] : static_cast<int>(rng() % n));
+
+        std::cout << "n = " << n << "                  insert    lookup    skewed   (Mops/s)\n";
+        run<Map<int, char>>("Map (AVL)", work);
+        run<BalancedMap<int, char, AvlBalance>>("AvlBalance", work);
+        run<BalancedMap<int, char, RedBlackBalance>>("RedBlackBalance", work);
+        run<BalancedMap<int, char, WeightBalance>>("WeightBalance", work);
+        run<BalancedMap<int, char, SplayBalance>>("SplayBalance", work);
+    }
+
+    return 0;
+}
+
+//---------------------------
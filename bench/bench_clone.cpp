@@ -0,0 +1,109 @@
+//---------------------------
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "../src/Map.hpp"
+
+//---------------------------
+
+// Map copy constructor and clone() on 1..hardware threads, and operator== on the copies.
+// Usage: bench_clone [n ...]   (default: 1000000 10000000)
+
+//---------------------------
+
+typedef std::chrono::steady_clock Clock;
+
+static_assert(std::is_nothrow_move_constructible<Map<int, char>>::value && std::is_nothrow_move_assignable<Map<int, char>>::value,
+              "std::vector<Map> has to move the maps when it grows, not copy them");
+
+//---------------------------
+
+// Growing a vector of maps moves them: every node stays where it was. Split and join still hand over the nodes
+static bool movesKeepNodes() {
+
+    std::vector<Map<int, char>> maps(1);
+    for(int i = 0; i < 1000; ++i)
+        maps[0].add(i, 'a');
+
+    const Node<int, char>* node = &*maps[0].find(500);
+
+    for(int i = 0; i < 100; ++i)
+        maps.emplace_back();
+
+    if(&*maps[0].find(500) != node)
+        return false;
+
+    Map<int, char> copy(maps[0]);
+
+    maps[0].split(500, maps[1]);
+    maps[0].join(maps[1]);
+
+    return maps[0] == copy && &*maps[0].find(500) == node;
+}
+
+//---------------------------
+
+static double ms(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+//---------------------------
+
+int main(int argc, char** argv) {
+
+    std::vector<size_t> sizes;
+    for(int i = 1; i < argc; ++i)
+        sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+
+    if(sizes.empty())
+        sizes = { 1000000, 10000000 };
+
+    if(!movesKeepNodes()) {
+        std::cerr << "moving a map copied or lost its nodes\n";
+        return 1;
+    }
+
+    unsigned hardware = std::thread::hardware_concurrency();
+    std::mt19937 rng(42);
+
+    for(size_t s = 0; s < sizes.size(); ++s) {
+
+        std::vector<int> keys(sizes[s]);
+        for(size_t i = 0; i < keys.size(); ++i)
+            keys[i] = static_cast<int>(i);
+
+        std::shuffle(keys.begin(), keys.end(), rng);
+
+        Map<int, char> map;
+        for(size_t i = 0; i < keys.size(); ++i)
+            map.add(keys[i], static_cast<char>('a' + (keys[i] & 15)));
+
+        Clock::time_point t0 = Clock::now();
+        Map<int, char> copy(map);
+        Clock::time_point t1 = Clock::now();
+        bool same = copy == map;
+        Clock::time_point t2 = Clock::now();
+
+        std::cout << "n = " << sizes[s] << "  copy " << ms(t0, t1) << " ms, == " << ms(t1, t2) << " ms" << (same ? "" : "  COPY DIFFERS") << "\n";
+
+        for(unsigned threads = 1; threads <= (hardware > 0 ? hardware : 1); threads *= 2) {
+
+            t0 = Clock::now();
+            Map<int, char> clone = map.clone(threads);
+            t1 = Clock::now();
+
+            std::cout << "  clone on " << threads << " threads " << ms(t0, t1) << " ms" << (clone == map ? "" : "  CLONE DIFFERS") << "\n";
+        }
+    }
+
+    return 0;
+}
+
+//---------------------------
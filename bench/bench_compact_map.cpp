@@ -0,0 +1,92 @@
+//---------------------------
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+
+#include "../src/Map.hpp"
+#include "../src/CompactMap.hpp"
+
+//---------------------------
+
+// Throughput and bytes per element of the pointer-linked Map and the index-linked CompactMap.
+// Usage: bench_compact_map [n ...]   (default: 1000000 10000000)
+
+//---------------------------
+
+typedef std::chrono::steady_clock Clock;
+
+//---------------------------
+
+static double mops(Clock::time_point from, Clock::time_point to, size_t ops) {
+    return static_cast<double>(ops) / std::chrono::duration<double>(to - from).count() * 1e-6;
+}
+
+//---------------------------
+
+template <class TMap>
+static void run(const char* name, const std::vector<int>& keys, const std::vector<int>& queries, double bytesPerElement) {
+
+    TMap map;
+    size_t found = 0;
+
+    Clock::time_point t0 = Clock::now();
+    for(size_t i = 0; i < keys.size(); ++i)
+        map.add(keys[i], 'a' + (keys[i] & 15));
+
+    Clock::time_point t1 = Clock::now();
+    for(size_t i = 0; i < queries.size(); ++i)
+        found += map.get(queries[i]) != nullptr;
+
+    Clock::time_point t2 = Clock::now();
+    for(size_t i = 0; i < keys.size(); ++i)
+        map.remove(keys[i]);
+
+    Clock::time_point t3 = Clock::now();
+
+    std::cout << "  " << name
+              << "  add: " << mops(t0, t1, keys.size()) << " Mops/s"
+              << "  get: " << mops(t1, t2, queries.size()) << " Mops/s"
+              << "  remove: " << mops(t2, t3, keys.size()) << " Mops/s"
+              << "  " << bytesPerElement << " bytes/element"
+              << "  (hits " << found << ")\n";
+}
+
+//---------------------------
+
+int main(int argc, char** argv) {
+
+    std::vector<size_t> sizes;
+    for(int i = 1; i < argc; ++i)
+        sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+
+    if(sizes.empty())
+        sizes = { 1000000, 10000000 };
+
+    std::mt19937 rng(42);
+
+    for(size_t s = 0; s < sizes.size(); ++s) {
+
+        std::vector<int> keys(sizes[s]);
+        for(size_t i = 0; i < keys.size(); ++i)
+            keys[i] = static_cast<int>(i * 2);
+
+        std::shuffle(keys.begin(), keys.end(), rng);
+
+        std::vector<int> queries(keys.size());
+        for(size_t i = 0; i < queries.size(); ++i)
+            queries[i] = static_cast<int>(rng() % (keys.size() * 2));
+
+        double compactBytes = sizeof(CompactMap<int, char>::Slot) + sizeof(char);
+
+        std::cout << "n = " << sizes[s] << "\n";
+        run<Map<int, char>>("Map       ", keys, queries, sizeof(Node<int, char>));
+        run<CompactMap<int, char>>("CompactMap", keys, queries, compactBytes);
+    }
+
+    return 0;
+}
+
+//---------------------------
@@ -0,0 +1,116 @@
+//---------------------------
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+
+#include "../src/ConcurrentMap.hpp"
+
+//---------------------------
+
+// Reader throughput of ConcurrentMap with one writer busy at the same time.
+// Usage: bench_concurrent_map [n] [max readers]   (default: 1000000 8)
+
+//---------------------------
+
+// A snapshot taken before clear() must keep the whole old tree, even while the writer reuses the memory
+static bool snapshotSurvivesClear() {
+
+    ConcurrentMap<int, char> map;
+    for(int i = 0; i < 10; ++i)
+        map.add(i, 'a');
+
+    ConcurrentMap<int, char>::Snapshot snapshot = map.snapshot();
+
+    map.clear();
+    for(int i = 100; i < 110; ++i)
+        map.add(i, 'b');
+
+    for(int i = 0; i < 10; ++i) {
+
+        const char* data = snapshot.get(i);
+        if(data == nullptr || *data != 'a')
+            return false;
+    }
+
+    return snapshot.get(100) == nullptr;
+}
+
+//---------------------------
+
+int main(int argc, char** argv) {
+
+    size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t maxReaders = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 8;
+
+    if(!snapshotSurvivesClear()) {
+        std::cerr << "a snapshot taken before clear() lost keys\n";
+        return 1;
+    }
+
+    ConcurrentMap<int, char> map;
+    for(size_t i = 0; i < n; ++i)
+        map.add(static_cast<int>(i), 'a' + (i & 15));
+
+    for(size_t readers = 1; readers <= maxReaders; readers *= 2) {
+
+        std::atomic<bool> stop(false);
+        std::atomic<size_t> reads(0);
+        std::atomic<size_t> writes(0);
+
+        std::thread writer([&]() {
+
+            std::mt19937 rng(7);
+            size_t count = 0;
+
+            while(!stop.load(std::memory_order_relaxed)) {
+
+                int key = static_cast<int>(rng() % (n * 2));
+
+                if(count & 1)
+                    map.remove(key);
+                else
+                    map.add(key, 'w');
+
+                ++count;
+            }
+
+            writes += count;
+        });
+
+        std::vector<std::thread> threads;
+        for(size_t t = 0; t < readers; ++t) {
+            threads.emplace_back([&, t]() {
+
+                std::mt19937 rng(static_cast<unsigned>(t));
+                size_t count = 0;
+                char data;
+
+                while(!stop.load(std::memory_order_relaxed)) {
+                    map.get(static_cast<int>(rng() % n), data);
+                    ++count;
+                }
+
+                reads += count;
+            });
+        }
+
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        stop = true;
+
+        writer.join();
+        for(size_t t = 0; t < threads.size(); ++t)
+            threads[t].join();
+
+        std::cout << "readers: " << readers
+                  << "  get: " << reads.load() * 1e-6 << " Mops/s"
+                  << "  writer: " << writes.load() * 1e-3 << " Kops/s\n";
+    }
+
+    return 0;
+}
+
+//---------------------------
@@ -0,0 +1,153 @@
+//---------------------------
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+
+#include "../src/Map.hpp"
+
+//---------------------------
+
+// Map::get / add / remove with and without finger search on key sequences that move by up to
+// d from one key to the next (d = 0 - uniformly random keys). Reports ns and comparisons per operation.
+// Usage: bench_finger_search [n]   (default: 1000000)
+
+//---------------------------
+
+typedef std::chrono::steady_clock Clock;
+typedef Map<int, char, NodePool<Node<int, char>>, true, true> CountingMap;
+
+//---------------------------
+
+static double perOp(double total, size_t ops) {
+    return total / static_cast<double>(ops);
+}
+
+//---------------------------
+
+static std::vector<int> walk(size_t count, int universe, int distance, std::mt19937& rng) {
+
+    std::vector<int> keys(count);
+    int key = universe / 2;
+
+    for(size_t i = 0; i < count; ++i) {
+
+        if(distance == 0)
+            key = static_cast<int>(rng() % static_cast<unsigned>(universe));
+        else
+            key = std::min(universe - 1, std::max(0, key + static_cast<int>(rng() % static_cast<unsigned>(2 * distance + 1)) - distance));
+
+        keys[i] = key;
+    }
+
+    return keys;
+}
+
+//---------------------------
+
+// Comparisons outside the lookups are counted too: equality, the sorted merge and the join checks
+static bool countsEveryComparison() {
+
+    CountingMap a, b, greater;
+    for(int i = 0; i < 100; ++i) {
+        a.add(i, 'a');
+        b.add(i, 'a');
+        greater.add(1000 + i, 'a');
+    }
+
+    a.resetStats();
+    bool equal = a == b;
+    bool counted = equal && a.stats().comparisons == 200; // two per pair of equal keys
+
+    std::vector<std::pair<int, char>> sorted = { { 50, 'b' }, { 200, 'b' } };
+
+    a.resetStats();
+    a.mergeSorted(sorted.begin(), sorted.end());
+    counted = counted && a.stats().comparisons >= 100;
+
+    b.resetStats();
+    b.join(greater);
+    counted = counted && b.stats().comparisons >= 1;
+
+    return counted;
+}
+
+//---------------------------
+
+static void run(CountingMap& map, const std::vector<int>& keys, bool finger) {
+
+    map.setFingerSearch(finger);
+
+    const char* names[] = { "get", "add", "remove" };
+
+    for(int op = 0; op < 3; ++op) {
+
+        map.resetStats();
+        size_t hits = 0;
+
+        Clock::time_point t0 = Clock::now();
+
+        for(size_t i = 0; i < keys.size(); ++i) {
+
+            // Every other key of the universe is in the map, add and remove toggle the odd ones
+            int key = op == 0 ? keys[i] : keys[i] | 1;
+
+            if(op == 0)
+                hits += map.get(key) != nullptr;
+            else if(op == 1)
+                hits += map.add(key, 'a');
+            else
+                hits += map.remove(key);
+        }
+
+        Clock::time_point t1 = Clock::now();
+
+        std::cout << "    " << (finger ? "finger " : "root   ") << names[op] << ": "
+                  << perOp(std::chrono::duration<double, std::nano>(t1 - t0).count(), keys.size()) << " ns, "
+                  << perOp(static_cast<double>(map.stats().comparisons), keys.size()) << " comparisons  (" << hits << " hits)\n";
+    }
+}
+
+//---------------------------
+
+int main(int argc, char** argv) {
+
+    size_t size = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    int universe = static_cast<int>(size * 2);
+
+    if(!countsEveryComparison()) {
+        std::cerr << "the counters missed comparisons\n";
+        return 1;
+    }
+
+    const size_t ops = 2000000;
+    std::mt19937 rng(42);
+
+    std::vector<int> keys(size);
+    for(size_t i = 0; i < size; ++i)
+        keys[i] = static_cast<int>(i * 2);
+
+    std::shuffle(keys.begin(), keys.end(), rng);
+
+    CountingMap map;
+    for(size_t i = 0; i < keys.size(); ++i)
+        map.add(keys[i], 'a');
+
+    const int distances[] = { 1, 16, 1024, 0 };
+
+    for(int d = 0; d < 4; ++d) {
+
+        std::vector<int> queries = walk(ops, universe, distances[d], rng);
+
+        std::cout << "n = " << size << ", d = " << (distances[d] ? std::to_string(distances[d]) : std::string("random")) << "\n";
+
+        run(map, queries, false);
+        run(map, queries, true);
+    }
+
+    return 0;
+}
+
+//---------------------------
@@ -0,0 +1,77 @@
+//---------------------------
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+
+#include "../src/Map.hpp"
+
+//---------------------------
+
+// Random hits against Map::get (node walk) and the frozen Eytzinger index.
+// Default sizes roughly fill L2, L3 and DRAM with Map<int, char> nodes.
+// Usage: bench_frozen_map [n ...]   (default: 8192 262144 8388608)
+
+//---------------------------
+
+typedef std::chrono::steady_clock Clock;
+
+//---------------------------
+
+static double nsPerOp(Clock::time_point from, Clock::time_point to, size_t ops) {
+    return std::chrono::duration<double, std::nano>(to - from).count() / static_cast<double>(ops);
+}
+
+//---------------------------
+
+int main(int argc, char** argv) {
+
+    std::vector<size_t> sizes;
+    for(int i = 1; i < argc; ++i)
+        sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+
+    if(sizes.empty())
+        sizes = { 8192, 262144, 8388608 };
+
+    const size_t lookups = 4000000;
+    std::mt19937 rng(42);
+
+    for(size_t s = 0; s < sizes.size(); ++s) {
+
+        std::vector<std::pair<int, char>> items(sizes[s]);
+        for(size_t i = 0; i < items.size(); ++i)
+            items[i] = { static_cast<int>(i * 2), static_cast<char>('a' + (i & 15)) };
+
+        Map<int, char> map;
+        map.assignSorted(items.begin(), items.end());
+
+        FrozenMap<int, char> frozen = map.freeze();
+
+        std::vector<int> queries(lookups);
+        for(size_t i = 0; i < queries.size(); ++i)
+            queries[i] = static_cast<int>(rng() % (items.size() * 2)); // half of them miss
+
+        size_t found = 0;
+
+        Clock::time_point t0 = Clock::now();
+        for(size_t i = 0; i < queries.size(); ++i)
+            found += map.get(queries[i]) != nullptr;
+
+        Clock::time_point t1 = Clock::now();
+        for(size_t i = 0; i < queries.size(); ++i)
+            found += frozen.get(queries[i]) != nullptr;
+
+        Clock::time_point t2 = Clock::now();
+
+        std::cout << "n = " << sizes[s]
+                  << "  Map::get: " << nsPerOp(t0, t1, lookups) << " ns"
+                  << "  FrozenMap::get: " << nsPerOp(t1, t2, lookups) << " ns"
+                  << "  (hits " << found << ")\n";
+    }
+
+    return 0;
+}
+
+//---------------------------
@@ -0,0 +1,82 @@
+//---------------------------
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+
+#include "../src/Map.hpp"
+
+//---------------------------
+
+// Map::getBatch against a loop of Map::get over the same batches of random keys.
+// Usage: bench_get_batch [batch size] [n ...]   (default: 256  8192 262144 8388608)
+
+//---------------------------
+
+typedef std::chrono::steady_clock Clock;
+
+//---------------------------
+
+static double nsPerOp(Clock::time_point from, Clock::time_point to, size_t ops) {
+    return std::chrono::duration<double, std::nano>(to - from).count() / static_cast<double>(ops);
+}
+
+//---------------------------
+
+int main(int argc, char** argv) {
+
+    size_t batch = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 256;
+
+    std::vector<size_t> sizes;
+    for(int i = 2; i < argc; ++i)
+        sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+
+    if(sizes.empty())
+        sizes = { 8192, 262144, 8388608 };
+
+    const size_t lookups = 4000000 / batch * batch;
+    std::mt19937 rng(42);
+
+    for(size_t s = 0; s < sizes.size(); ++s) {
+
+        // Random insertion order scatters the nodes over the pool like a long-lived map
+        std::vector<int> keys(sizes[s]);
+        for(size_t i = 0; i < keys.size(); ++i)
+            keys[i] = static_cast<int>(i * 2);
+
+        std::shuffle(keys.begin(), keys.end(), rng);
+
+        Map<int, char> map;
+        for(size_t i = 0; i < keys.size(); ++i)
+            map.add(keys[i], 'a' + (keys[i] & 15));
+
+        std::vector<int> queries(lookups);
+        for(size_t i = 0; i < queries.size(); ++i)
+            queries[i] = static_cast<int>(rng() % (keys.size() * 2)); // half of them miss
+
+        std::vector<const char*> out(batch);
+        size_t foundLoop = 0,
+               foundBatch = 0;
+
+        Clock::time_point t0 = Clock::now();
+        for(size_t i = 0; i < queries.size(); ++i)
+            foundLoop += map.get(queries[i]) != nullptr;
+
+        Clock::time_point t1 = Clock::now();
+        for(size_t i = 0; i < queries.size(); i += batch)
+            foundBatch += map.getBatch(&queries[i], batch, out.data());
+
+        Clock::time_point t2 = Clock::now();
+
+        std::cout << "n = " << sizes[s]
+                  << "  get loop: " << nsPerOp(t0, t1, lookups) << " ns"
+                  << "  getBatch(" << batch << "): " << nsPerOp(t1, t2, lookups) << " ns"
+                  << "  (hits " << foundLoop << " / " << foundBatch << ")\n";
+    }
+
+    return 0;
+}
+
+//---------------------------
@@ -0,0 +1,111 @@
+//---------------------------
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "../src/Map.hpp"
+
+//---------------------------
+
+// Map::get without and with the hot-key cache (256 and 4096 slots) on Zipf(s) queries.
+// Usage: bench_hot_cache [s] [n ...]   (default: 0.99  1000000 10000000)
+
+//---------------------------
+
+typedef std::chrono::steady_clock Clock;
+
+typedef Map<int, char> PlainMap;
+typedef Map<int, char, NodePool<Node<int, char>>, true, false, 256> SmallCacheMap;
+typedef Map<int, char, NodePool<Node<int, char>>, true, false, 4096> LargeCacheMap;
+
+//---------------------------
+
+static double nsPerOp(Clock::time_point from, Clock::time_point to, size_t ops) {
+    return std::chrono::duration<double, std::nano>(to - from).count() / static_cast<double>(ops);
+}
+
+//---------------------------
+
+// Rank r of the power law is key hot[r], so the hot keys are spread over the whole tree
+static std::vector<int> zipfKeys(size_t count, const std::vector<int>& hot, double s, std::mt19937& rng) {
+
+    size_t universe = hot.size();
+
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    double top = std::pow(static_cast<double>(universe) + 1.0, 1.0 - s) - 1.0;
+
+    std::vector<int> keys(count);
+    for(size_t i = 0; i < count; ++i) {
+
+        size_t rank = static_cast<size_t>(std::pow(top * uniform(rng) + 1.0, 1.0 / (1.0 - s))) - 1;
+        keys[i] = hot[rank < universe ? rank : universe - 1];
+    }
+
+    return keys;
+}
+
+//---------------------------
+
+template <class TMap>
+static void run(const char* name, const std::vector<int>& keys, const std::vector<int>& queries) {
+
+    TMap map;
+    for(size_t i = 0; i < keys.size(); ++i)
+        map.add(keys[i], static_cast<char>('a' + (keys[i] & 15)));
+
+    size_t hits = 0;
+
+    Clock::time_point t0 = Clock::now();
+    for(size_t i = 0; i < queries.size(); ++i)
+        hits += map.get(queries[i]) != nullptr;
+
+    Clock::time_point t1 = Clock::now();
+
+    HotCacheCounters cache = map.cacheStats();
+    double rate = cache.hits + cache.misses > 0 ? 100.0 * static_cast<double>(cache.hits) / static_cast<double>(cache.hits + cache.misses) : 0.0;
+
+    std::cout << "  " << name << ": " << nsPerOp(t0, t1, queries.size()) << " ns/get, cache hit rate " << rate << "%"
+              << (hits == queries.size() ? "" : "  MISSING KEYS") << "\n";
+}
+
+//---------------------------
+
+int main(int argc, char** argv) {
+
+    double s = argc > 1 ? std::strtod(argv[1], nullptr) : 0.99;
+
+    std::vector<size_t> sizes;
+    for(int i = 2; i < argc; ++i)
+        sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+
+    if(sizes.empty())
+        sizes = { 1000000, 10000000 };
+
+    const size_t lookups = 4000000;
+    std::mt19937 rng(42);
+
+    for(size_t n = 0; n < sizes.size(); ++n) {
+
+        std::vector<int> keys(sizes[n]);
+        for(size_t i = 0; i < keys.size(); ++i)
+            keys[i] = static_cast<int>(i);
+
+        std::shuffle(keys.begin(), keys.end(), rng);
+
+        std::vector<int> queries = zipfKeys(lookups, keys, s, rng);
+
+        std::cout << "n = " << sizes[n] << ", zipf " << s << "\n";
+
+        run<PlainMap>("no cache  ", keys, queries);
+        run<SmallCacheMap>("256 slots ", keys, queries);
+        run<LargeCacheMap>("4096 slots", keys, queries);
+    }
+
+    return 0;
+}
+
+//---------------------------
@@ -0,0 +1,79 @@
+//---------------------------
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include "../src/Map.hpp"
+
+//---------------------------
+
+// Map::getTree() against Map::exportLayout() into a reused TreeLayout, on random keys.
+// getTree() builds a fresh vector of records every call, exportLayout() writes the
+// same nodes with their level and offset into buffers that keep their capacity.
+// Usage: bench_layout_export [n]   (default: 1000000)
+
+//---------------------------
+
+typedef std::chrono::steady_clock Clock;
+
+//---------------------------
+
+static double nsPerNode(Clock::time_point from, Clock::time_point to, size_t runs, size_t nodes) {
+    return std::chrono::duration<double, std::nano>(to - from).count() / static_cast<double>(runs * (nodes > 0 ? nodes : 1));
+}
+
+//---------------------------
+
+int main(int argc, char** argv) {
+
+    size_t size = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    const size_t runs = 10;
+
+    std::mt19937 rng(42);
+
+    std::vector<int> keys(size);
+    for(size_t i = 0; i < size; ++i)
+        keys[i] = static_cast<int>(i);
+
+    std::shuffle(keys.begin(), keys.end(), rng);
+
+    Map<int, char> map;
+    for(size_t i = 0; i < keys.size(); ++i)
+        map.add(keys[i], static_cast<char>('a' + (keys[i] & 15)));
+
+    long long sink = 0;
+
+    Clock::time_point t0 = Clock::now();
+
+    for(size_t r = 0; r < runs; ++r) {
+        std::vector<DataS<int, char>> tree = map.getTree();
+        sink += static_cast<long long>(tree.size()) + tree.back().level;
+    }
+
+    Clock::time_point t1 = Clock::now();
+
+    TreeLayout<int, char> layout;
+    map.exportLayout(layout);
+
+    Clock::time_point t2 = Clock::now();
+
+    for(size_t r = 0; r < runs; ++r) {
+        map.exportLayout(layout);
+        sink += static_cast<long long>(layout.size()) + layout.levels.back();
+    }
+
+    Clock::time_point t3 = Clock::now();
+
+    std::cout << "n = " << size << ", " << runs << " runs\n"
+              << "    getTree:              " << nsPerNode(t0, t1, runs, size) << " ns/node\n"
+              << "    exportLayout (warm):  " << nsPerNode(t2, t3, runs, size) << " ns/node\n"
+              << "    levels: " << layout.levelCount << "  (checksum " << sink << ")\n";
+
+    return 0;
+}
+
+//---------------------------
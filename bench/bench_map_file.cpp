@@ -0,0 +1,70 @@
+//---------------------------
+
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "../src/Map.hpp"
+
+//---------------------------
+
+// Map::save / Map::load and an in-place MappedMap against rebuilding the tree with add().
+// Usage: bench_map_file [n] [path]   (default: 10000000 bench_map_file.bin)
+
+//---------------------------
+
+typedef std::chrono::steady_clock Clock;
+
+//---------------------------
+
+static double ms(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+//---------------------------
+
+int main(int argc, char** argv) {
+
+    size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    const char* path = argc > 2 ? argv[2] : "bench_map_file.bin";
+
+    Map<int, char> map;
+
+    Clock::time_point t0 = Clock::now();
+    for(size_t i = 0; i < count; ++i)
+        map.add(static_cast<int>((i * 2654435761u) % count), static_cast<char>('a' + (i & 15)));
+
+    Clock::time_point t1 = Clock::now();
+    bool saved = map.save(path);
+
+    Clock::time_point t2 = Clock::now();
+    Map<int, char> loaded;
+    bool ok = loaded.load(path);
+
+    Clock::time_point t3 = Clock::now();
+    MappedMap<int, char> mapped;
+    bool opened = mapped.open(path, false);
+
+    Clock::time_point t4 = Clock::now();
+
+    size_t same = 0;
+    for(size_t i = 0; i < count; i += 97) {
+        const char* a = loaded.get(static_cast<int>(i));
+        const char* b = mapped.get(static_cast<int>(i));
+        same += a && b && *a == *b;
+    }
+
+    std::cout << "n = " << count
+              << "  add: " << ms(t0, t1) << " ms"
+              << "  save: " << ms(t1, t2) << " ms" << (saved ? "" : " (failed)")
+              << "  load: " << ms(t2, t3) << " ms" << (ok ? "" : " (failed)")
+              << "  map in place: " << ms(t3, t4) << " ms" << (opened ? "" : " (failed)")
+              << "  (matching " << same << ")\n";
+
+    std::remove(path);
+
+    return 0;
+}
+
+//---------------------------
@@ -0,0 +1,85 @@
+//---------------------------
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+
+#include "../src/Map.hpp"
+
+//---------------------------
+
+// Insert/clear throughput of the slab pool against plain new/delete nodes.
+// Usage: bench_node_pool [n ...]   (default: 1000000 10000000)
+
+//---------------------------
+
+typedef std::chrono::steady_clock Clock;
+
+//---------------------------
+
+static double seconds(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double>(to - from).count();
+}
+
+//---------------------------
+
+template <class TMap>
+static void run(const char* name, const std::vector<int>& keys) {
+
+    TMap map;
+
+    Clock::time_point t0 = Clock::now();
+    for(size_t i = 0; i < keys.size(); ++i)
+        map.add(keys[i], 'a' + (keys[i] & 15));
+
+    Clock::time_point t1 = Clock::now();
+    map.clear();
+    Clock::time_point t2 = Clock::now();
+
+    // Second round reuses whatever the allocator kept around
+    for(size_t i = 0; i < keys.size(); ++i)
+        map.add(keys[i], 'a');
+
+    Clock::time_point t3 = Clock::now();
+    map.clear();
+
+    double n = static_cast<double>(keys.size());
+
+    std::cout << "  " << name
+              << "  insert: " << n / seconds(t0, t1) * 1e-6 << " Mops/s"
+              << "  clear: " << seconds(t1, t2) * 1e3 << " ms"
+              << "  re-insert: " << n / seconds(t2, t3) * 1e-6 << " Mops/s\n";
+}
+
+//---------------------------
+
+int main(int argc, char** argv) {
+
+    std::vector<size_t> sizes;
+    for(int i = 1; i < argc; ++i)
+        sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+
+    if(sizes.empty())
+        sizes = { 1000000, 10000000 };
+
+    std::mt19937 rng(42);
+
+    for(size_t s = 0; s < sizes.size(); ++s) {
+
+        std::vector<int> keys(sizes[s]);
+        for(size_t i = 0; i < keys.size(); ++i)
+            keys[i] = static_cast<int>(i);
+
+        std::shuffle(keys.begin(), keys.end(), rng);
+
+        std::cout << "n = " << sizes[s] << " (random order)\n";
+        run<Map<int, char, HeapNodeAllocator<Node<int, char>>>>("new/delete", keys);
+        run<Map<int, char>>("node pool ", keys);
+    }
+
+    return 0;
+}
+
+//---------------------------
@@ -0,0 +1,278 @@
+//---------------------------
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <vector>
+#include <cstdlib>
+#include <new>
+
+#include <SFML/Graphics.hpp>
+
+#include "../src/TreeRenderer.hpp"
+
+//---------------------------
+
+// Frame time of the tree cells for 1K, 10K and 100K nodes, drawn into an offscreen texture:
+// one draw call per cell quad (how TreeRenderer drew them before) against all cells in one
+// vertex array, and a whole TreeRenderer frame. Needs SFML and a display for the GL context.
+// Checks first that the selection and the warm rebuilds of TreeRenderer behave.
+// Usage: bench_render_batch [frames]   (default: 200)
+
+//---------------------------
+
+typedef std::chrono::steady_clock Clock;
+
+static size_t allocations = 0;
+
+//---------------------------
+
+void* operator new(std::size_t size) {
+
+    ++allocations;
+
+    if(void* memory = std::malloc(size > 0 ? size : 1))
+        return memory;
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+//---------------------------
+
+// A view patched from the change log selects the same cells as one built fresh, and moving down picks the left child first
+static bool selectionFollowsTree() {
+
+    std::mt19937 rng(11);
+
+    Map<int, char> map;
+    for(int i = 0; i < 200; ++i)
+        map.add(static_cast<int>(rng() % 1000), 'a');
+
+    TreeLayout<int, char> layout;
+    map.exportLayout(layout);
+
+    TreeRenderer<int, char> patched;
+    patched.setSize(640.0f, 480.0f);
+    patched.activate();
+    patched.buildFromLayout(layout);
+
+    map.setChangeLog(true);
+
+    const int moves[][2] = { { 0, 1 }, { 0, 1 }, { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 }, { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, 1 } };
+
+    for(int step = 0; step < 1000; ++step) {
+
+        for(int i = 0; i < 5; ++i) {
+            if(rng() & 1)
+                map.add(static_cast<int>(rng() % 1000), 'b');
+            else
+                map.remove(static_cast<int>(rng() % 1000));
+        }
+
+        map.exportLayout(layout);
+
+        if(!patched.applyChanges(map.getChanges()))
+            patched.buildFromLayout(layout);
+
+        map.clearChanges();
+
+        if(layout.size() == 0)
+            continue;
+
+        TreeRenderer<int, char> fresh;
+        fresh.setSize(640.0f, 480.0f);
+        fresh.activate();
+        fresh.buildFromLayout(layout);
+
+        patched.clearSelection();
+        fresh.clearSelection();
+
+        for(size_t m = 0; m < sizeof(moves) / sizeof(moves[0]); ++m) {
+
+            // Nothing is selected before the first move, which has to pick the root
+            const Node<int, char>* from = m > 0 ? &*map.find(patched.getSelectedItemKey()) : nullptr;
+
+            patched.moveSelection(moves[m][0], moves[m][1]);
+            fresh.moveSelection(moves[m][0], moves[m][1]);
+
+            int key = patched.getSelectedItemKey();
+
+            if(key != fresh.getSelectedItemKey() || (!from && key != layout.keys[0]) ||
+               (from && moves[m][1] > 0 && from->left && key != from->left->key))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+//---------------------------
+
+// Heap allocations of buildFromLayout() switching between two trees, once every item has held the labels of both
+static size_t warmBuildAllocations() {
+
+    std::mt19937 rng(9);
+
+    Map<int, char> large, small;
+    for(int i = 0; i < 50000; ++i)
+        large.add(static_cast<int>(rng() % 1000000), static_cast<char>('a' + i % 26));
+    for(int i = 0; i < 40000; ++i)
+        small.add(static_cast<int>(rng() % 1000000), 'b');
+
+    TreeLayout<int, char> largeLayout, smallLayout;
+    large.exportLayout(largeLayout);
+    small.exportLayout(smallLayout);
+
+    TreeRenderer<int, char> renderer;
+    renderer.setSize(640.0f, 480.0f);
+
+    renderer.buildFromLayout(largeLayout);
+    renderer.buildFromLayout(smallLayout);
+    renderer.buildFromLayout(largeLayout);
+
+    size_t before = allocations;
+
+    renderer.buildFromLayout(smallLayout);
+    renderer.buildFromLayout(largeLayout);
+    renderer.buildFromLayout(largeLayout);
+
+    return allocations - before;
+}
+
+//---------------------------
+
+// The quads of TreeRenderer::resizeItem() for a view of the given size
+static std::vector<sf::Vertex> cellQuads(const TreeLayout<int, char>& layout, const sf::Vector2f& size) {
+
+    std::vector<sf::Vertex> quads(layout.size() * 4);
+
+    for(size_t i = 0; i < layout.size(); ++i) {
+
+        float itemHeight = size.y / layout.levelCount,
+              itemWidth = size.x / static_cast<float>(uint64_t(1) << layout.levels[i]);
+
+        unsigned char comp = (layout.levels[i] + 1) * 64 / layout.levelCount;
+        sf::Color color = layout.offsets[i] & 1 ? sf::Color(comp, comp, comp) : sf::Color(200, comp, comp);
+
+        sf::Vector2f from(static_cast<float>(layout.offsets[i]) * itemWidth, layout.levels[i] * itemHeight);
+
+        quads[i * 4 + 0] = sf::Vertex(from, color);
+        quads[i * 4 + 1] = sf::Vertex(sf::Vector2f(from.x + itemWidth, from.y), color);
+        quads[i * 4 + 2] = sf::Vertex(sf::Vector2f(from.x + itemWidth, from.y + itemHeight), color);
+        quads[i * 4 + 3] = sf::Vertex(sf::Vector2f(from.x, from.y + itemHeight), color);
+    }
+
+    return quads;
+}
+
+//---------------------------
+
+// Milliseconds per frame, the texture is read back at the end so the GPU work is in the time as well
+template <class Frame>
+static double msPerFrame(sf::RenderTexture& texture, size_t frames, Frame frame) {
+
+    Clock::time_point t0 = Clock::now();
+
+    for(size_t f = 0; f < frames; ++f) {
+        texture.clear();
+        frame();
+        texture.display();
+    }
+
+    texture.getTexture().copyToImage();
+
+    Clock::time_point t1 = Clock::now();
+
+    return std::chrono::duration<double, std::milli>(t1 - t0).count() / static_cast<double>(frames);
+}
+
+//---------------------------
+
+int main(int argc, char** argv) {
+
+    size_t frames = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200;
+
+    if(!selectionFollowsTree()) {
+        std::cerr << "bench_render_batch: the selection of a patched view went elsewhere\n";
+        return 1;
+    }
+
+    if(size_t count = warmBuildAllocations()) {
+        std::cerr << "bench_render_batch: warm buildFromLayout() allocated " << count << " times\n";
+        return 1;
+    }
+
+    const sf::Vector2f size(1280.0f, 720.0f);
+
+    sf::RenderTexture texture;
+    if(!texture.create(static_cast<unsigned>(size.x), static_cast<unsigned>(size.y))) {
+        std::cerr << "bench_render_batch: no render texture\n";
+        return 1;
+    }
+
+    std::mt19937 rng(42);
+
+    const size_t sizes[] = { 1000, 10000, 100000 };
+
+    for(size_t count : sizes) {
+
+        std::vector<int> keys(count);
+        for(size_t i = 0; i < count; ++i)
+            keys[i] = static_cast<int>(i);
+
+        std::shuffle(keys.begin(), keys.end(), rng);
+
+        Map<int, char> map;
+        for(size_t i = 0; i < keys.size(); ++i)
+            map.add(keys[i], static_cast<char>('a' + (keys[i] & 15)));
+
+        TreeLayout<int, char> layout;
+        map.exportLayout(layout);
+
+        std::vector<sf::Vertex> quads = cellQuads(layout, size);
+
+        sf::VertexArray cells(sf::PrimitiveType::Triangles, count * 6);
+        for(size_t i = 0; i < count; ++i) {
+
+            const int corners[] = { 0, 1, 2, 0, 2, 3 };
+            for(int c = 0; c < 6; ++c)
+                cells[i * 6 + c] = quads[i * 4 + corners[c]];
+        }
+
+        double perQuad = msPerFrame(texture, frames, [&]() {
+            for(size_t i = 0; i < count; ++i)
+                texture.draw(&quads[i * 4], 4, sf::PrimitiveType::TriangleFan);
+        });
+
+        double batched = msPerFrame(texture, frames, [&]() {
+            texture.draw(cells);
+        });
+
+        // No font is set, the signs cost their draw calls but put nothing on screen
+        TreeRenderer<int, char> renderer;
+        renderer.setSize(size.x, size.y);
+        renderer.buildFromLayout(layout);
+
+        double whole = msPerFrame(texture, frames, [&]() {
+            texture.draw(renderer);
+        });
+
+        std::cout << "n = " << count << "\n"
+                  << "    cells, one draw per quad:   " << perQuad << " ms/frame\n"
+                  << "    cells, one vertex array:    " << batched << " ms/frame\n"
+                  << "    TreeRenderer frame:         " << whole << " ms/frame\n";
+    }
+
+    return 0;
+}
+
+//---------------------------
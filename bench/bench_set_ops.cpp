@@ -0,0 +1,106 @@
+//---------------------------
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <cstdlib>
+
+#include "../src/Map.hpp"
+
+//---------------------------
+
+// Join-based unionWith / intersect / difference against add/remove loops, for several thread counts.
+// Usage: bench_set_ops [n] [m] [max threads]   (default: 1000000 100000 hardware threads)
+
+//---------------------------
+
+typedef std::chrono::steady_clock Clock;
+typedef Map<int, char> IntMap;
+
+//---------------------------
+
+static double ms(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+//---------------------------
+
+static void fill(IntMap& map, std::vector<int>& keys, size_t count, unsigned seed) {
+
+    std::mt19937 rng(seed);
+    keys.clear();
+
+    for(size_t i = 0; i < count; ++i) {
+        int key = static_cast<int>(rng() % (count * 4));
+        keys.push_back(key);
+        map.add(key, 'a' + (key & 15));
+    }
+}
+
+//---------------------------
+
+int main(int argc, char** argv) {
+
+    size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t m = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100000;
+    unsigned maxThreads = argc > 3 ? static_cast<unsigned>(std::strtoul(argv[3], nullptr, 10)) : std::thread::hardware_concurrency();
+
+    if(maxThreads == 0)
+        maxThreads = 1;
+
+    std::vector<int> bigKeys, smallKeys;
+    IntMap small;
+
+    { IntMap big; fill(big, bigKeys, n, 1); }
+    fill(small, smallKeys, m, 2);
+
+    std::cout << "n = " << n << ", m = " << m << "\n";
+
+    // Baseline: the same results through single-element calls
+    {
+        IntMap map;
+        fill(map, bigKeys, n, 1);
+
+        Clock::time_point t0 = Clock::now();
+        for(size_t i = 0; i < smallKeys.size(); ++i)
+            map.add(smallKeys[i], 'a' + (smallKeys[i] & 15));
+
+        Clock::time_point t1 = Clock::now();
+        for(size_t i = 0; i < smallKeys.size(); ++i)
+            map.remove(smallKeys[i]);
+
+        Clock::time_point t2 = Clock::now();
+
+        std::cout << "  loop       add: " << ms(t0, t1) << " ms  remove: " << ms(t1, t2) << " ms\n";
+    }
+
+    for(unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+
+        IntMap unionMap, intersectMap, differenceMap;
+
+        fill(unionMap, bigKeys, n, 1);
+        fill(intersectMap, bigKeys, n, 1);
+        fill(differenceMap, bigKeys, n, 1);
+
+        Clock::time_point t0 = Clock::now();
+        unionMap.unionWith(small, threads);
+
+        Clock::time_point t1 = Clock::now();
+        intersectMap.intersect(small, threads);
+
+        Clock::time_point t2 = Clock::now();
+        differenceMap.difference(small, threads);
+
+        Clock::time_point t3 = Clock::now();
+
+        std::cout << "  threads: " << threads
+                  << "  union: " << ms(t0, t1) << " ms"
+                  << "  intersect: " << ms(t1, t2) << " ms"
+                  << "  difference: " << ms(t2, t3) << " ms\n";
+    }
+
+    return 0;
+}
+
+//---------------------------
@@ -0,0 +1,167 @@
+//---------------------------
+
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <queue>
+#include <thread>
+
+#include "../src/Map.hpp"
+
+//---------------------------
+
+// getPrintHorizontal / getPrintVertical (flat TreeOrder engine) against the former
+// std::queue + std::map implementation, on the same tree. Both must print the same text,
+// also when four threads print the map at the same time (run under TSan for the races).
+// Usage: bench_tree_orders [n ...]   (default: 1000000)
+
+//---------------------------
+
+typedef std::chrono::steady_clock Clock;
+
+//---------------------------
+
+static double ms(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+//---------------------------
+
+static std::string queueHorizontal(const Node<int, char>* root) {
+
+    std::string data;
+    std::queue<const Node<int, char>*> q;
+
+    if(root)
+        q.push(root);
+
+    while(!q.empty()) {
+
+        const Node<int, char>* current = q.front();
+        q.pop();
+
+        data += std::to_string(current->key) + " ";
+
+        if(current->left) q.push(current->left);
+        if(current->right) q.push(current->right);
+    }
+
+    return data;
+}
+
+//---------------------------
+
+static std::string mapVertical(const Node<int, char>* root) {
+
+    std::string data;
+    std::map<int, std::vector<const Node<int, char>*>> nodes;
+    std::queue<std::pair<const Node<int, char>*, int>> q;
+
+    if(root)
+        q.push({ root, 0 });
+
+    while(!q.empty()) {
+
+        std::pair<const Node<int, char>*, int> current = q.front();
+        q.pop();
+
+        nodes[current.second].push_back(current.first);
+
+        if(current.first->left) q.push({ current.first->left, current.second - 1 });
+        if(current.first->right) q.push({ current.first->right, current.second + 1 });
+    }
+
+    for(const auto& column : nodes) {
+        for(const Node<int, char>* node : column.second)
+            data += std::to_string(node->key) + " ";
+        data += "\n";
+    }
+
+    return data;
+}
+
+//---------------------------
+
+int main(int argc, char** argv) {
+
+    std::vector<size_t> sizes;
+    for(int i = 1; i < argc; ++i)
+        sizes.push_back(std::strtoull(argv[i], nullptr, 10));
+
+    if(sizes.empty())
+        sizes = { 1000000 };
+
+    std::mt19937 rng(42);
+
+    for(size_t s = 0; s < sizes.size(); ++s) {
+
+        std::vector<int> keys(sizes[s]);
+        for(size_t i = 0; i < keys.size(); ++i)
+            keys[i] = static_cast<int>(i);
+
+        std::shuffle(keys.begin(), keys.end(), rng);
+
+        Map<int, char> map;
+        for(size_t i = 0; i < keys.size(); ++i)
+            map.add(keys[i], 'a');
+
+        const Node<int, char>* root = &*map.find(keys[0]);
+        while(root->parent)
+            root = root->parent;
+
+        Clock::time_point t0 = Clock::now();
+        std::string oldHorizontal = queueHorizontal(root);
+        Clock::time_point t1 = Clock::now();
+        std::string oldVertical = mapVertical(root);
+        Clock::time_point t2 = Clock::now();
+        std::string newHorizontal = map.getPrintHorizontal();
+        Clock::time_point t3 = Clock::now();
+        std::string newVertical = map.getPrintVertical();
+        Clock::time_point t4 = Clock::now();
+
+        // The same with buffers kept by the caller, the first run sizes them
+        TreeOrder<Node<int, char>> order;
+        std::string againVertical;
+        {
+            TextSink sink(againVertical);
+            map.writeVertical(sink, order);
+        }
+
+        againVertical.clear();
+
+        Clock::time_point t5 = Clock::now();
+        {
+            TextSink sink(againVertical);
+            map.writeVertical(sink, order);
+        }
+        Clock::time_point t6 = Clock::now();
+
+        // Concurrent const readers, each call keeps its own buffers
+        std::vector<std::string> printed(4);
+        std::vector<std::thread> threads;
+
+        for(size_t t = 0; t < printed.size(); ++t)
+            threads.emplace_back([&map, &printed, t]() {
+                printed[t] = t & 1 ? map.getPrintVertical() : map.getPrintHorizontal();
+            });
+
+        bool concurrentSame = true;
+        for(size_t t = 0; t < threads.size(); ++t) {
+            threads[t].join();
+            concurrentSame = concurrentSame && printed[t] == (t & 1 ? newVertical : newHorizontal);
+        }
+
+        std::cout << "n = " << sizes[s]
+                  << "  horizontal: queue " << ms(t0, t1) << " ms, flat " << ms(t2, t3) << " ms"
+                  << "  vertical: queue+map " << ms(t1, t2) << " ms, flat " << ms(t3, t4) << " ms (warm " << ms(t5, t6) << " ms)"
+                  << ((oldHorizontal == newHorizontal && oldVertical == newVertical && newVertical == againVertical && concurrentSame) ? "" : "  OUTPUT DIFFERS")
+                  << "\n";
+    }
+
+    return 0;
+}
+
+//---------------------------
@@ -0,0 +1,305 @@
+//---------------------------
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+
+#include "../src/Map.hpp"
+
+//---------------------------
+
+// Map against std::map and std::unordered_map: add, get, remove, getCountElement,
+// getTree and traversals for sizes 1K..10M and sequential, random and Zipf keys.
+// Results go to stdout as a table and to a JSON file for regression tracking.
+// Usage: map_bench [--max-size n] [--json path]   (default: 10000000 map_bench.json)
+
+//---------------------------
+
+typedef std::chrono::steady_clock Clock;
+typedef Map<int, char> TreeMap;
+
+//---------------------------
+
+struct Result {
+    std::string container;
+    std::string distribution;
+    size_t size;
+    std::string operation;
+    double nsPerOp;
+};
+
+//---------------------------
+
+static double nsPerOp(Clock::time_point from, Clock::time_point to, size_t ops) {
+    return std::chrono::duration<double, std::nano>(to - from).count() / static_cast<double>(ops > 0 ? ops : 1);
+}
+
+//---------------------------
+
+static char dataOf(int key) {
+    return static_cast<char>('a' + (key & 15));
+}
+
+//---------------------------
+
+// The containers differ in how they spell the same operations
+static bool add(TreeMap& map, int key) { return map.add(key, dataOf(key)); }
+static bool add(std::map<int, char>& map, int key) { return map.emplace(key, dataOf(key)).second; }
+static bool add(std::unordered_map<int, char>& map, int key) { return map.emplace(key, dataOf(key)).second; }
+
+static bool get(TreeMap& map, int key) { return map.get(key) != nullptr; }
+static bool get(std::map<int, char>& map, int key) { return map.find(key) != map.end(); }
+static bool get(std::unordered_map<int, char>& map, int key) { return map.find(key) != map.end(); }
+
+static bool remove(TreeMap& map, int key) { return map.remove(key); }
+static bool remove(std::map<int, char>& map, int key) { return map.erase(key) != 0; }
+static bool remove(std::unordered_map<int, char>& map, int key) { return map.erase(key) != 0; }
+
+static size_t countElement(const TreeMap& map, char data) { return map.getCountElement(data); }
+
+template <class TMap>
+static size_t countElement(const TMap& map, char data) {
+
+    size_t counter = 0;
+    for(typename TMap::const_iterator it = map.begin(); it != map.end(); ++it)
+        counter += it->second == data;
+
+    return counter;
+}
+
+static long long inorderSum(const TreeMap& map) {
+
+    long long sum = 0;
+    map.traverse(TraversalOrder::Inorder, [&sum](const Node<int, char>& node) { sum += node.key; });
+
+    return sum;
+}
+
+// std::unordered_map goes in bucket order, it is still one pass over every element
+template <class TMap>
+static long long inorderSum(const TMap& map) {
+
+    long long sum = 0;
+    for(typename TMap::const_iterator it = map.begin(); it != map.end(); ++it)
+        sum += it->first;
+
+    return sum;
+}
+
+//---------------------------
+
+// Operations only Map has, nothing for the others
+template <class TMap>
+static void runTreeOnly(TMap&, const std::string&, size_t, std::vector<Result>&, long long&) {}
+
+static void runTreeOnly(TreeMap& map, const std::string& distribution, size_t size, std::vector<Result>& results, long long& sink) {
+
+    static const TraversalOrder orders[] = { TraversalOrder::Preorder, TraversalOrder::Postorder, TraversalOrder::LevelOrder };
+    static const char* names[] = { "traverse_preorder", "traverse_postorder", "traverse_levelorder" };
+
+    for(int i = 0; i < 3; ++i) {
+
+        long long sum = 0;
+
+        Clock::time_point t0 = Clock::now();
+        map.traverse(orders[i], [&sum](const Node<int, char>& node) { sum += node.key; });
+        Clock::time_point t1 = Clock::now();
+
+        sink += sum;
+        results.push_back({ "Map", distribution, size, names[i], nsPerOp(t0, t1, size) });
+    }
+
+    Clock::time_point t0 = Clock::now();
+    std::vector<DataS<int, char>> tree = map.getTree();
+    Clock::time_point t1 = Clock::now();
+
+    sink += static_cast<long long>(tree.size());
+    results.push_back({ "Map", distribution, size, "getTree", nsPerOp(t0, t1, tree.size()) });
+}
+
+//---------------------------
+
+template <class TMap>
+static void run(const char* name, const std::string& distribution, const std::vector<int>& keys, const std::vector<int>& queries,
+                std::vector<Result>& results, long long& sink) {
+
+    TMap map;
+    size_t size = keys.size();
+    size_t hits = 0;
+
+    Clock::time_point t0 = Clock::now();
+    for(size_t i = 0; i < keys.size(); ++i)
+        hits += add(map, keys[i]);
+
+    Clock::time_point t1 = Clock::now();
+    for(size_t i = 0; i < queries.size(); ++i)
+        hits += get(map, queries[i]);
+
+    Clock::time_point t2 = Clock::now();
+
+    results.push_back({ name, distribution, size, "add", nsPerOp(t0, t1, keys.size()) });
+    results.push_back({ name, distribution, size, "get", nsPerOp(t1, t2, queries.size()) });
+
+    const size_t countCalls = 16;
+
+    t0 = Clock::now();
+    for(size_t i = 0; i < countCalls; ++i)
+        hits += countElement(map, dataOf(static_cast<int>(i)));
+
+    t1 = Clock::now();
+    sink += inorderSum(map);
+    t2 = Clock::now();
+
+    results.push_back({ name, distribution, size, "getCountElement", nsPerOp(t0, t1, countCalls) });
+    results.push_back({ name, distribution, size, "traverse_inorder", nsPerOp(t1, t2, size) });
+
+    runTreeOnly(map, distribution, size, results, sink);
+
+    t0 = Clock::now();
+    for(size_t i = 0; i < keys.size(); ++i)
+        hits += remove(map, keys[i]);
+
+    t1 = Clock::now();
+
+    results.push_back({ name, distribution, size, "remove", nsPerOp(t0, t1, keys.size()) });
+
+    sink += static_cast<long long>(hits);
+}
+
+//---------------------------
+
+// Zipf(s) draws by inverting the continuous power law. Rank r is key hot[r], so the hot keys are spread over the key space
+static std::vector<int> zipfKeys(size_t count, const std::vector<int>& hot, double s, std::mt19937& rng) {
+
+    size_t universe = hot.size();
+
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    double top = std::pow(static_cast<double>(universe) + 1.0, 1.0 - s) - 1.0;
+
+    std::vector<int> keys(count);
+    for(size_t i = 0; i < count; ++i) {
+
+        size_t rank = static_cast<size_t>(std::pow(top * uniform(rng) + 1.0, 1.0 / (1.0 - s))) - 1;
+        keys[i] = hot[rank < universe ? rank : universe - 1];
+    }
+
+    return keys;
+}
+
+//---------------------------
+
+static void writeJson(const std::vector<Result>& results, std::ostream& out) {
+
+    out << "{\n  \"benchmark\": \"map_bench\",\n  \"unit\": \"ns/op\",\n  \"results\": [\n";
+
+    for(size_t i = 0; i < results.size(); ++i) {
+
+        const Result& r = results[i];
+
+        out << "    { \"container\": \"" << r.container
+            << "\", \"distribution\": \"" << r.distribution
+            << "\", \"size\": " << r.size
+            << ", \"operation\": \"" << r.operation
+            << "\", \"ns_per_op\": " << std::fixed << std::setprecision(3) << r.nsPerOp
+            << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+
+    out << "  ]\n}\n";
+}
+
+//---------------------------
+
+int main(int argc, char** argv) {
+
+    size_t maxSize = 10000000;
+    const char* jsonPath = "map_bench.json";
+
+    for(int i = 1; i + 1 < argc; i += 2) {
+
+        if(std::strcmp(argv[i], "--max-size") == 0)
+            maxSize = std::strtoull(argv[i + 1], nullptr, 10);
+
+        else if(std::strcmp(argv[i], "--json") == 0)
+            jsonPath = argv[i + 1];
+
+        else {
+            std::cerr << "usage: map_bench [--max-size n] [--json path]\n";
+            return 1;
+        }
+    }
+
+    std::vector<Result> results;
+    std::mt19937 rng(42);
+    long long sink = 0;
+
+    for(size_t size = 1000; size <= maxSize; size *= 10) {
+
+        const char* distributions[] = { "sequential", "random", "zipf" };
+
+        for(int d = 0; d < 3; ++d) {
+
+            std::vector<int> keys, queries;
+
+            if(d == 2) {
+
+                std::vector<int> hot(size);
+                for(size_t i = 0; i < size; ++i)
+                    hot[i] = static_cast<int>(i);
+
+                std::shuffle(hot.begin(), hot.end(), rng);
+
+                keys = zipfKeys(size, hot, 0.99, rng);
+                queries = zipfKeys(size, hot, 0.99, rng);
+
+            } else {
+
+                keys.resize(size);
+                for(size_t i = 0; i < size; ++i)
+                    keys[i] = static_cast<int>(i);
+
+                queries = keys;
+
+                if(d == 1) {
+                    std::shuffle(keys.begin(), keys.end(), rng);
+                    std::shuffle(queries.begin(), queries.end(), rng);
+                }
+            }
+
+            run<TreeMap>("Map", distributions[d], keys, queries, results, sink);
+            run<std::map<int, char>>("std::map", distributions[d], keys, queries, results, sink);
+            run<std::unordered_map<int, char>>("std::unordered_map", distributions[d], keys, queries, results, sink);
+
+            std::cerr << "size " << size << ", " << distributions[d] << " done\n";
+        }
+    }
+
+    std::cout << std::left << std::setw(20) << "container" << std::setw(12) << "keys" << std::setw(10) << "size"
+              << std::setw(22) << "operation" << "ns/op\n";
+
+    for(size_t i = 0; i < results.size(); ++i) {
+
+        const Result& r = results[i];
+
+        std::cout << std::left << std::setw(20) << r.container << std::setw(12) << r.distribution << std::setw(10) << r.size
+                  << std::setw(22) << r.operation << std::fixed << std::setprecision(1) << r.nsPerOp << "\n";
+    }
+
+    std::ofstream json(jsonPath);
+    writeJson(results, json);
+
+    std::cout << "results written to " << jsonPath << " (checksum " << sink << ")\n";
+
+    return json ? 0 : 1;
+}
+
+//---------------------------
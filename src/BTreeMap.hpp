@@ -0,0 +1,712 @@
+//---------------------------
+
+#ifndef BTREEMAP_HPP_INCLUDED
+#define BTREEMAP_HPP_INCLUDED
+
+//---------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    #include <immintrin.h>
+#endif
+
+#include "Map.hpp"
+#include "NodePool.hpp"
+
+//---------------------------
+
+template <class Key, class Data, size_t NodeKeys>
+struct BTreeLeaf {
+
+    Key keys[NodeKeys];
+    Data data[NodeKeys];
+
+    unsigned count = 0;
+
+    BTreeLeaf* next = nullptr;
+};
+
+//---------------------------
+
+template <class Key, size_t NodeKeys>
+struct BTreeInner {
+
+    Key keys[NodeKeys];
+    void* children[NodeKeys + 1];
+
+    unsigned count = 0;
+};
+
+//---------------------------
+
+/*
+ * B+-tree with the same interface as Map.
+ *
+ * Inner nodes hold NodeKeys separators (child i keeps keys in [keys[i-1], keys[i])),
+ * leaves hold up to NodeKeys sorted pairs and are chained through next. The
+ * position inside a node is a rank count over the whole key block, vectorised
+ * for signed 32-bit keys, so there are no data-dependent branches per key.
+ * Nodes below half occupancy borrow from or merge with a sibling.
+ */
+template <class Key, class Data, size_t NodeKeys = 32>
+class BTreeMap {
+public:
+
+    static_assert(NodeKeys >= 16 && NodeKeys <= 64 && NodeKeys % 8 == 0, "BTreeMap: NodeKeys must be 16, 24, ..., 64");
+
+    typedef BTreeLeaf<Key, Data, NodeKeys> Leaf;
+    typedef BTreeInner<Key, NodeKeys> Inner;
+
+    BTreeMap() = default;
+    ~BTreeMap() { this->clear(); }
+
+    BTreeMap(const BTreeMap&) = delete;
+    BTreeMap& operator=(const BTreeMap&) = delete;
+
+    //---------------------------
+
+    bool add(const Key& key, const Data& data) {
+        return this->add({ key, data });
+    }
+
+    //---------------------------
+
+    bool add(const std::pair<Key, Data>& pair) {
+
+        const Key& key = pair.first;
+
+        if(!pRoot) {
+
+            Leaf* leaf = createLeaf();
+            leaf->keys[0] = key;
+            leaf->data[0] = pair.second;
+            leaf->count = 1;
+
+            pRoot = leaf;
+            pHeight = 0;
+
+            return true;
+        }
+
+        Inner* path[maxDepth];
+        unsigned slots[maxDepth];
+
+        Leaf* leaf = this->findLeaf(key, path, slots);
+        unsigned pos = countLess(leaf->keys, leaf->count, key);
+
+        if(pos < leaf->count && !(key < leaf->keys[pos]))
+            return false;
+
+        if(leaf->count < NodeKeys) {
+            insertIntoLeaf(leaf, pos, pair);
+            return true;
+        }
+
+        // Split the full leaf in halves and push the first key of the right one up
+        Leaf* right = createLeaf();
+        unsigned mid = NodeKeys / 2;
+
+        for(unsigned i = mid; i < NodeKeys; ++i) {
+            right->keys[i - mid] = leaf->keys[i];
+            right->data[i - mid] = leaf->data[i];
+        }
+
+        right->count = NodeKeys - mid;
+        leaf->count = mid;
+
+        right->next = leaf->next;
+        leaf->next = right;
+
+        if(pos <= mid)
+            insertIntoLeaf(leaf, pos, pair);
+        else
+            insertIntoLeaf(right, pos - mid, pair);
+
+        this->insertIntoParents(path, slots, right->keys[0], right);
+
+        return true;
+    }
+
+    //---------------------------
+
+    Data* get(const Key& key) {
+
+        if(!pRoot)
+            return nullptr;
+
+        void* node = pRoot;
+
+        for(int d = 0; d < pHeight; ++d) {
+            Inner* inner = static_cast<Inner*>(node);
+            node = inner->children[countLessEqual(inner->keys, inner->count, key)];
+        }
+
+        Leaf* leaf = static_cast<Leaf*>(node);
+        unsigned pos = countLess(leaf->keys, leaf->count, key);
+
+        if(pos < leaf->count && !(key < leaf->keys[pos]))
+            return &leaf->data[pos];
+
+        return nullptr;
+    }
+
+    //---------------------------
+
+    bool remove(const Key& key) {
+
+        if(!pRoot)
+            return false;
+
+        Inner* path[maxDepth];
+        unsigned slots[maxDepth];
+
+        Leaf* leaf = this->findLeaf(key, path, slots);
+        unsigned pos = countLess(leaf->keys, leaf->count, key);
+
+        if(pos >= leaf->count || key < leaf->keys[pos])
+            return false;
+
+        for(unsigned i = pos + 1; i < leaf->count; ++i) {
+            leaf->keys[i - 1] = leaf->keys[i];
+            leaf->data[i - 1] = leaf->data[i];
+        }
+
+        --leaf->count;
+
+        if(pHeight == 0) {
+
+            if(leaf->count == 0) {
+                destroyLeaf(leaf);
+                pRoot = nullptr;
+            }
+
+            return true;
+        }
+
+        if(leaf->count < minKeys)
+            this->fixLeaf(leaf, path[pHeight - 1], slots[pHeight - 1]);
+
+        for(int d = pHeight - 1; d > 0 && path[d]->count < minKeys; --d)
+            this->fixInner(path[d], path[d - 1], slots[d - 1]);
+
+        Inner* root = static_cast<Inner*>(pRoot);
+        if(pHeight > 0 && root->count == 0) {
+            pRoot = root->children[0];
+            destroyInner(root);
+            --pHeight;
+        }
+
+        return true;
+    }
+
+    //---------------------------
+
+    void clear() {
+
+        if(!pRoot)
+            return;
+
+        if(!std::is_trivially_destructible<Leaf>::value || !std::is_trivially_destructible<Inner>::value)
+            this->destroyAll(pRoot, 0);
+
+        pLeaves.release();
+        pInners.release();
+
+        pRoot = nullptr;
+        pHeight = 0;
+    }
+
+    //---------------------------
+
+    size_t getCountElement(Data data) {
+
+        size_t counter = 0;
+
+        for(const Leaf* leaf = this->firstLeaf(); leaf; leaf = leaf->next)
+            for(unsigned i = 0; i < leaf->count; ++i)
+                if(leaf->data[i] == data)
+                    ++counter;
+
+        return counter;
+    }
+
+    //---------------------------
+
+    ///Same records as Map::getTree(), laid out as a balanced binary tree over the sorted pairs.
+    ///The nodes are owned by the map and stay valid until the next getTree() or clear()
+    std::vector<DataS<Key, Data>> getTree() {
+
+        pExport.clear();
+
+        for(const Leaf* leaf = this->firstLeaf(); leaf; leaf = leaf->next) {
+            for(unsigned i = 0; i < leaf->count; ++i) {
+
+                Node<Key, Data> node;
+                node.node(leaf->keys[i], leaf->data[i]);
+
+                pExport.push_back(node);
+            }
+        }
+
+        std::vector<DataS<Key, Data>> buff;
+        buff.reserve(pExport.size());
+
+        this->exportRange(0, pExport.size(), 0, 0, buff);
+
+        return buff;
+    }
+
+    //---------------------------
+
+private:
+
+    static constexpr unsigned minKeys = NodeKeys / 2;
+    static constexpr int maxDepth = 32;
+
+    void* pRoot = nullptr;
+    int pHeight = 0; // number of inner levels above the leaves
+
+    NodePool<Leaf> pLeaves;
+    NodePool<Inner> pInners;
+
+    std::vector<Node<Key, Data>> pExport;
+
+    //---------------------------
+
+    Leaf* createLeaf() {
+        return new (pLeaves.allocate()) Leaf();
+    }
+
+    //---------------------------
+
+    Inner* createInner() {
+        return new (pInners.allocate()) Inner();
+    }
+
+    //---------------------------
+
+    void destroyLeaf(Leaf* leaf) {
+        leaf->~Leaf();
+        pLeaves.deallocate(leaf);
+    }
+
+    //---------------------------
+
+    void destroyInner(Inner* inner) {
+        inner->~Inner();
+        pInners.deallocate(inner);
+    }
+
+    //---------------------------
+
+    void destroyAll(void* node, int depth) {
+
+        if(depth == pHeight) {
+            static_cast<Leaf*>(node)->~Leaf();
+            return;
+        }
+
+        Inner* inner = static_cast<Inner*>(node);
+
+        for(unsigned i = 0; i <= inner->count; ++i)
+            this->destroyAll(inner->children[i], depth + 1);
+
+        inner->~Inner();
+    }
+
+    //---------------------------
+
+    Leaf* firstLeaf() const {
+
+        void* node = pRoot;
+
+        for(int d = 0; node && d < pHeight; ++d)
+            node = static_cast<Inner*>(node)->children[0];
+
+        return static_cast<Leaf*>(node);
+    }
+
+    //---------------------------
+
+    Leaf* findLeaf(const Key& key, Inner* path[], unsigned slots[]) {
+
+        void* node = pRoot;
+
+        for(int d = 0; d < pHeight; ++d) {
+
+            Inner* inner = static_cast<Inner*>(node);
+            unsigned slot = countLessEqual(inner->keys, inner->count, key);
+
+            path[d] = inner;
+            slots[d] = slot;
+
+            node = inner->children[slot];
+        }
+
+        return static_cast<Leaf*>(node);
+    }
+
+    //---------------------------
+
+    static void insertIntoLeaf(Leaf* leaf, unsigned pos, const std::pair<Key, Data>& pair) {
+
+        for(unsigned i = leaf->count; i > pos; --i) {
+            leaf->keys[i] = leaf->keys[i - 1];
+            leaf->data[i] = leaf->data[i - 1];
+        }
+
+        leaf->keys[pos] = pair.first;
+        leaf->data[pos] = pair.second;
+
+        ++leaf->count;
+    }
+
+    //---------------------------
+
+    static void insertIntoInner(Inner* inner, unsigned slot, const Key& separator, void* child) {
+
+        for(unsigned i = inner->count; i > slot; --i) {
+            inner->keys[i] = inner->keys[i - 1];
+            inner->children[i + 1] = inner->children[i];
+        }
+
+        inner->keys[slot] = separator;
+        inner->children[slot + 1] = child;
+
+        ++inner->count;
+    }
+
+    //---------------------------
+
+    // Inserts separator/child right of path[d]->children[slots[d]], splitting full inner nodes on the way up
+    void insertIntoParents(Inner* path[], unsigned slots[], Key separator, void* child) {
+
+        for(int d = pHeight - 1; d >= 0; --d) {
+
+            Inner* inner = path[d];
+
+            if(inner->count < NodeKeys) {
+                insertIntoInner(inner, slots[d], separator, child);
+                return;
+            }
+
+            // NodeKeys + 1 separators: the left half stays, the middle one goes up, the rest moves right
+            Key keys[NodeKeys + 1];
+            void* children[NodeKeys + 2];
+
+            unsigned slot = slots[d];
+
+            for(unsigned i = 0, j = 0; i <= NodeKeys; ++i)
+                keys[i] = i == slot ? separator : inner->keys[j++];
+
+            for(unsigned i = 0, j = 0; i <= NodeKeys + 1; ++i)
+                children[i] = i == slot + 1 ? child : inner->children[j++];
+
+            Inner* right = createInner();
+            unsigned mid = (NodeKeys + 1) / 2;
+
+            for(unsigned i = 0; i < mid; ++i) {
+                inner->keys[i] = keys[i];
+                inner->children[i] = children[i];
+            }
+
+            inner->children[mid] = children[mid];
+            inner->count = mid;
+
+            for(unsigned i = mid + 1; i <= NodeKeys; ++i) {
+                right->keys[i - mid - 1] = keys[i];
+                right->children[i - mid - 1] = children[i];
+            }
+
+            right->children[NodeKeys - mid] = children[NodeKeys + 1];
+            right->count = NodeKeys - mid;
+
+            separator = keys[mid];
+            child = right;
+        }
+
+        Inner* root = createInner();
+
+        root->keys[0] = separator;
+        root->children[0] = pRoot;
+        root->children[1] = child;
+        root->count = 1;
+
+        pRoot = root;
+        ++pHeight;
+    }
+
+    //---------------------------
+
+    void fixLeaf(Leaf* leaf, Inner* parent, unsigned slot) {
+
+        Leaf* left = slot > 0 ? static_cast<Leaf*>(parent->children[slot - 1]) : nullptr;
+        Leaf* right = slot < parent->count ? static_cast<Leaf*>(parent->children[slot + 1]) : nullptr;
+
+        if(left && left->count > minKeys) {
+
+            for(unsigned i = leaf->count; i > 0; --i) {
+                leaf->keys[i] = leaf->keys[i - 1];
+                leaf->data[i] = leaf->data[i - 1];
+            }
+
+            --left->count;
+            leaf->keys[0] = left->keys[left->count];
+            leaf->data[0] = left->data[left->count];
+            ++leaf->count;
+
+            parent->keys[slot - 1] = leaf->keys[0];
+
+        } else if(right && right->count > minKeys) {
+
+            leaf->keys[leaf->count] = right->keys[0];
+            leaf->data[leaf->count] = right->data[0];
+            ++leaf->count;
+
+            for(unsigned i = 1; i < right->count; ++i) {
+                right->keys[i - 1] = right->keys[i];
+                right->data[i - 1] = right->data[i];
+            }
+
+            --right->count;
+
+            parent->keys[slot] = right->keys[0];
+
+        } else if(left) {
+
+            mergeLeaves(left, leaf);
+            removeFromInner(parent, slot - 1);
+
+        } else {
+
+            mergeLeaves(leaf, right);
+            removeFromInner(parent, slot);
+        }
+    }
+
+    //---------------------------
+
+    void mergeLeaves(Leaf* left, Leaf* right) {
+
+        for(unsigned i = 0; i < right->count; ++i) {
+            left->keys[left->count + i] = right->keys[i];
+            left->data[left->count + i] = right->data[i];
+        }
+
+        left->count += right->count;
+        left->next = right->next;
+
+        destroyLeaf(right);
+    }
+
+    //---------------------------
+
+    void fixInner(Inner* inner, Inner* parent, unsigned slot) {
+
+        Inner* left = slot > 0 ? static_cast<Inner*>(parent->children[slot - 1]) : nullptr;
+        Inner* right = slot < parent->count ? static_cast<Inner*>(parent->children[slot + 1]) : nullptr;
+
+        if(left && left->count > minKeys) {
+
+            // Rotate through the parent: the separator comes down, the last key of left goes up
+            inner->children[inner->count + 1] = inner->children[inner->count];
+            for(unsigned i = inner->count; i > 0; --i) {
+                inner->keys[i] = inner->keys[i - 1];
+                inner->children[i] = inner->children[i - 1];
+            }
+
+            inner->keys[0] = parent->keys[slot - 1];
+            inner->children[0] = left->children[left->count];
+            ++inner->count;
+
+            --left->count;
+            parent->keys[slot - 1] = left->keys[left->count];
+
+        } else if(right && right->count > minKeys) {
+
+            inner->keys[inner->count] = parent->keys[slot];
+            inner->children[inner->count + 1] = right->children[0];
+            ++inner->count;
+
+            parent->keys[slot] = right->keys[0];
+
+            for(unsigned i = 1; i < right->count; ++i) {
+                right->keys[i - 1] = right->keys[i];
+                right->children[i - 1] = right->children[i];
+            }
+
+            right->children[right->count - 1] = right->children[right->count];
+            --right->count;
+
+        } else if(left) {
+
+            mergeInners(left, parent->keys[slot - 1], inner);
+            removeFromInner(parent, slot - 1);
+
+        } else {
+
+            mergeInners(inner, parent->keys[slot], right);
+            removeFromInner(parent, slot);
+        }
+    }
+
+    //---------------------------
+
+    void mergeInners(Inner* left, const Key& separator, Inner* right) {
+
+        left->keys[left->count] = separator;
+
+        for(unsigned i = 0; i < right->count; ++i) {
+            left->keys[left->count + 1 + i] = right->keys[i];
+            left->children[left->count + 1 + i] = right->children[i];
+        }
+
+        left->children[left->count + 1 + right->count] = right->children[right->count];
+        left->count += right->count + 1;
+
+        destroyInner(right);
+    }
+
+    //---------------------------
+
+    // Drops keys[slot] together with the child right of it
+    static void removeFromInner(Inner* inner, unsigned slot) {
+
+        for(unsigned i = slot + 1; i < inner->count; ++i) {
+            inner->keys[i - 1] = inner->keys[i];
+            inner->children[i] = inner->children[i + 1];
+        }
+
+        --inner->count;
+    }
+
+    //---------------------------
+
+    Node<Key, Data>* exportRange(size_t from, size_t to, int level, int state, std::vector<DataS<Key, Data>>& data) {
+
+        if(from >= to)
+            return nullptr;
+
+        size_t mid = from + (to - from - 1) / 2;
+        Node<Key, Data>* node = &pExport[mid];
+
+        DataS<Key, Data> buff;
+        buff.node = node;
+        buff.level = level;
+        buff.state = state;
+
+        data.push_back(buff);
+
+        node->left = this->exportRange(from, mid, level + 1, 1, data);
+        node->right = this->exportRange(mid + 1, to, level + 1, 2, data);
+
+        return node;
+    }
+
+    //---------------------------
+
+    // Signed 32-bit keys are ranked with SSE2/AVX2 compares over the whole node, masked to count
+#if defined(__SSE2__)
+    static constexpr bool simdKeys = std::is_integral<Key>::value && std::is_signed<Key>::value && sizeof(Key) == 4;
+#else
+    static constexpr bool simdKeys = false;
+#endif
+
+    //---------------------------
+
+    // Number of keys[0..count) that are less than key
+    static unsigned countLess(const Key* keys, unsigned count, const Key& key) {
+
+        if constexpr(simdKeys)
+            return popcount64(greaterMask<false>(keys, key) & lowBits(count));
+
+        unsigned n = 0;
+        for(unsigned i = 0; i < count; ++i)
+            n += keys[i] < key;
+
+        return n;
+    }
+
+    //---------------------------
+
+    // Number of keys[0..count) that are not greater than key
+    static unsigned countLessEqual(const Key* keys, unsigned count, const Key& key) {
+
+        if constexpr(simdKeys)
+            return count - popcount64(greaterMask<true>(keys, key) & lowBits(count));
+
+        unsigned n = 0;
+        for(unsigned i = 0; i < count; ++i)
+            n += !(key < keys[i]);
+
+        return n;
+    }
+
+    //---------------------------
+
+    static uint64_t lowBits(unsigned count) {
+        return count >= 64 ? ~uint64_t(0) : (uint64_t(1) << count) - 1;
+    }
+
+    //---------------------------
+
+    static unsigned popcount64(uint64_t mask) {
+        return static_cast<unsigned>(__builtin_popcountll(mask));
+    }
+
+    //---------------------------
+
+#if defined(__SSE2__)
+
+    // KeysGreater: bit i = keys[i] > key, otherwise bit i = keys[i] < key, for all NodeKeys slots
+    template <bool KeysGreater>
+    static uint64_t greaterMask(const Key* keys, const Key& key) {
+
+        uint64_t mask = 0;
+
+#if defined(__AVX2__)
+        __m256i k = _mm256_set1_epi32(static_cast<int32_t>(key));
+
+        for(unsigned i = 0; i < NodeKeys; i += 8) {
+
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+            __m256i c = KeysGreater ? _mm256_cmpgt_epi32(v, k) : _mm256_cmpgt_epi32(k, v);
+
+            mask |= static_cast<uint64_t>(static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(c)))) << i;
+        }
+#else
+        __m128i k = _mm_set1_epi32(static_cast<int32_t>(key));
+
+        for(unsigned i = 0; i < NodeKeys; i += 4) {
+
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i));
+            __m128i c = KeysGreater ? _mm_cmpgt_epi32(v, k) : _mm_cmpgt_epi32(k, v);
+
+            mask |= static_cast<uint64_t>(static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(c)))) << i;
+        }
+#endif
+
+        return mask;
+    }
+
+#else
+
+    template <bool KeysGreater>
+    static uint64_t greaterMask(const Key*, const Key&) {
+        return 0;
+    }
+
+#endif
+};
+
+//---------------------------
+
+#endif // BTREEMAP_HPP_INCLUDED
+
+//---------------------------
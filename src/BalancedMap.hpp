@@ -0,0 +1,782 @@
+//---------------------------
+
+#ifndef BALANCEDMAP_HPP_INCLUDED
+#define BALANCEDMAP_HPP_INCLUDED
+
+//---------------------------
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Map.hpp"
+#include "NodePool.hpp"
+
+//---------------------------
+
+template <class Key, class Data, class State>
+struct BalancedNode {
+
+    Key key;
+    Data data;
+
+    BalancedNode* left = nullptr;
+    BalancedNode* right = nullptr;
+    BalancedNode* parent = nullptr;
+
+    State state = State(); // whatever the balancing policy keeps per node
+};
+
+//---------------------------
+
+/*
+ * Balancing policies of BalancedMap.
+ *
+ * A policy names the State it keeps in every node and is told about the
+ * changes of the tree: inserted() after a new leaf is linked, erased() after
+ * a node is unlinked (child took its place under parent, removed is the state
+ * that left that position), accessed() after a lookup ended on node. It may
+ * restructure the tree through the rotations below, which call update() on
+ * the two nodes whose subtrees changed.
+ */
+template <class Policy>
+struct BalancePolicy {
+
+    template <class Node>
+    static void update(Node*) {}
+
+    template <class Node>
+    static void accessed(Node*&, Node*) {}
+
+    //---------------------------
+
+    template <class Node>
+    static void rotateLeft(Node*& root, Node* x) {
+
+        Node* y = x->right;
+
+        x->right = y->left;
+        if(y->left)
+            y->left->parent = x;
+
+        replaceChild(root, x, y);
+
+        y->left = x;
+        x->parent = y;
+
+        Policy::update(x);
+        Policy::update(y);
+    }
+
+    //---------------------------
+
+    template <class Node>
+    static void rotateRight(Node*& root, Node* x) {
+
+        Node* y = x->left;
+
+        x->left = y->right;
+        if(y->right)
+            y->right->parent = x;
+
+        replaceChild(root, x, y);
+
+        y->right = x;
+        x->parent = y;
+
+        Policy::update(x);
+        Policy::update(y);
+    }
+
+    //---------------------------
+
+    // Hangs y where x was
+    template <class Node>
+    static void replaceChild(Node*& root, Node* x, Node* y) {
+
+        y->parent = x->parent;
+
+        if(!x->parent)
+            root = y;
+
+        else if(x == x->parent->left)
+            x->parent->left = y;
+
+        else
+            x->parent->right = y;
+    }
+};
+
+//---------------------------
+
+///Height-balanced, the same rules as Map
+struct AvlBalance : BalancePolicy<AvlBalance> {
+
+    typedef unsigned char State; // subtree height
+
+    template <class Node>
+    static void update(Node* node) {
+
+        unsigned char hl = height(node->left),
+                      hr = height(node->right);
+
+        node->state = (hl > hr ? hl : hr) + 1;
+    }
+
+    template <class Node>
+    static void inserted(Node*& root, Node* node) {
+        node->state = 1;
+        retrace(root, node->parent);
+    }
+
+    template <class Node>
+    static void erased(Node*& root, Node*, Node* parent, State) {
+        retrace(root, parent);
+    }
+
+private:
+
+    template <class Node>
+    static unsigned char height(const Node* node) {
+        return node ? node->state : 0;
+    }
+
+    template <class Node>
+    static int balanceFactor(const Node* node) {
+        return height(node->right) - height(node->left);
+    }
+
+    template <class Node>
+    static void retrace(Node*& root, Node* node) {
+
+        while(node) {
+
+            unsigned char oldHeight = node->state;
+
+            update(node);
+
+            if(balanceFactor(node) == 2) {
+                if(balanceFactor(node->right) < 0)
+                    rotateRight(root, node->right);
+                rotateLeft(root, node);
+                node = node->parent;
+            }
+
+            else if(balanceFactor(node) == -2) {
+                if(balanceFactor(node->left) > 0)
+                    rotateLeft(root, node->left);
+                rotateRight(root, node);
+                node = node->parent;
+            }
+
+            if(node->state == oldHeight)
+                break;
+
+            node = node->parent;
+        }
+    }
+};
+
+//---------------------------
+
+///Red-black, at most two rotations per insert and three per removal
+struct RedBlackBalance : BalancePolicy<RedBlackBalance> {
+
+    typedef bool State; // red
+
+    template <class Node>
+    static void inserted(Node*& root, Node* node) {
+
+        node->state = true;
+
+        while(node->parent && node->parent->state) {
+
+            Node* parent = node->parent;
+            Node* grand = parent->parent; // a red parent is never the root
+
+            if(parent == grand->left) {
+
+                Node* uncle = grand->right;
+
+                if(isRed(uncle)) {
+                    parent->state = uncle->state = false;
+                    grand->state = true;
+                    node = grand;
+                    continue;
+                }
+
+                if(node == parent->right) {
+                    rotateLeft(root, parent);
+                    parent = node;
+                }
+
+                parent->state = false;
+                grand->state = true;
+                rotateRight(root, grand);
+
+                break;
+
+            } else {
+
+                Node* uncle = grand->left;
+
+                if(isRed(uncle)) {
+                    parent->state = uncle->state = false;
+                    grand->state = true;
+                    node = grand;
+                    continue;
+                }
+
+                if(node == parent->left) {
+                    rotateRight(root, parent);
+                    parent = node;
+                }
+
+                parent->state = false;
+                grand->state = true;
+                rotateLeft(root, grand);
+
+                break;
+            }
+        }
+
+        root->state = false;
+    }
+
+    template <class Node>
+    static void erased(Node*& root, Node* node, Node* parent, State removedRed) {
+
+        if(removedRed)
+            return;
+
+        // node carries an extra black until it is red, the root, or the sibling side can take it over
+        while(node != root && !isRed(node)) {
+
+            if(node == parent->left) {
+
+                Node* sibling = parent->right;
+
+                if(isRed(sibling)) {
+                    sibling->state = false;
+                    parent->state = true;
+                    rotateLeft(root, parent);
+                    sibling = parent->right;
+                }
+
+                if(!isRed(sibling->left) && !isRed(sibling->right)) {
+                    sibling->state = true;
+                    node = parent;
+                    parent = node->parent;
+                    continue;
+                }
+
+                if(!isRed(sibling->right)) {
+                    sibling->left->state = false;
+                    sibling->state = true;
+                    rotateRight(root, sibling);
+                    sibling = parent->right;
+                }
+
+                sibling->state = parent->state;
+                parent->state = false;
+                sibling->right->state = false;
+                rotateLeft(root, parent);
+
+            } else {
+
+                Node* sibling = parent->left;
+
+                if(isRed(sibling)) {
+                    sibling->state = false;
+                    parent->state = true;
+                    rotateRight(root, parent);
+                    sibling = parent->left;
+                }
+
+                if(!isRed(sibling->left) && !isRed(sibling->right)) {
+                    sibling->state = true;
+                    node = parent;
+                    parent = node->parent;
+                    continue;
+                }
+
+                if(!isRed(sibling->left)) {
+                    sibling->right->state = false;
+                    sibling->state = true;
+                    rotateLeft(root, sibling);
+                    sibling = parent->left;
+                }
+
+                sibling->state = parent->state;
+                parent->state = false;
+                sibling->left->state = false;
+                rotateRight(root, parent);
+            }
+
+            node = root;
+        }
+
+        if(node)
+            node->state = false;
+    }
+
+private:
+
+    template <class Node>
+    static bool isRed(const Node* node) {
+        return node && node->state;
+    }
+};
+
+//---------------------------
+
+///Weight-balanced (BB[alpha] with delta = 3, gamma = 2), keeps subtree sizes in every node
+struct WeightBalance : BalancePolicy<WeightBalance> {
+
+    typedef size_t State; // subtree size
+
+    static constexpr size_t delta = 3,
+                            gamma = 2;
+
+    template <class Node>
+    static void update(Node* node) {
+        node->state = size(node->left) + size(node->right) + 1;
+    }
+
+    template <class Node>
+    static void inserted(Node*& root, Node* node) {
+        node->state = 1;
+        retrace(root, node->parent);
+    }
+
+    template <class Node>
+    static void erased(Node*& root, Node*, Node* parent, State) {
+        retrace(root, parent);
+    }
+
+private:
+
+    template <class Node>
+    static size_t size(const Node* node) {
+        return node ? node->state : 0;
+    }
+
+    // Every size up to the root changes, so there is no early exit
+    template <class Node>
+    static void retrace(Node*& root, Node* node) {
+
+        while(node) {
+
+            update(node);
+
+            size_t wl = size(node->left) + 1,
+                   wr = size(node->right) + 1;
+
+            if(wr > delta * wl) {
+
+                Node* right = node->right;
+
+                if(size(right->left) + 1 >= gamma * (size(right->right) + 1))
+                    rotateRight(root, right);
+
+                rotateLeft(root, node);
+                node = node->parent;
+            }
+
+            else if(wl > delta * wr) {
+
+                Node* left = node->left;
+
+                if(size(left->right) + 1 >= gamma * (size(left->left) + 1))
+                    rotateLeft(root, left);
+
+                rotateRight(root, node);
+                node = node->parent;
+            }
+
+            node = node->parent;
+        }
+    }
+};
+
+//---------------------------
+
+///Splay tree, every access moves its node to the root, amortised O(log n) and fast on skewed access
+struct SplayBalance : BalancePolicy<SplayBalance> {
+
+    typedef unsigned char State; // unused
+
+    template <class Node>
+    static void inserted(Node*& root, Node* node) {
+        splay(root, node);
+    }
+
+    template <class Node>
+    static void erased(Node*& root, Node*, Node* parent, State) {
+        if(parent)
+            splay(root, parent);
+    }
+
+    template <class Node>
+    static void accessed(Node*& root, Node* node) {
+        splay(root, node);
+    }
+
+private:
+
+    template <class Node>
+    static void splay(Node*& root, Node* node) {
+
+        while(Node* parent = node->parent) {
+
+            Node* grand = parent->parent;
+            bool left = node == parent->left;
+
+            if(!grand)
+                left ? rotateRight(root, parent) : rotateLeft(root, parent);
+
+            else if(left == (parent == grand->left)) {
+
+                // zig-zig: the grandparent goes first
+                if(left) {
+                    rotateRight(root, grand);
+                    rotateRight(root, parent);
+                } else {
+                    rotateLeft(root, grand);
+                    rotateLeft(root, parent);
+                }
+
+            } else {
+
+                // zig-zag
+                if(left) {
+                    rotateRight(root, parent);
+                    rotateLeft(root, grand);
+                } else {
+                    rotateLeft(root, parent);
+                    rotateRight(root, grand);
+                }
+            }
+        }
+    }
+};
+
+//---------------------------
+
+/*
+ * Binary search tree with the same interface as Map and the balancing
+ * chosen at compile time through Balance (AvlBalance, RedBlackBalance,
+ * WeightBalance or SplayBalance). The tree walks themselves are shared,
+ * the policy only sees the nodes it has to fix up.
+ * Nothing in here recurses, splay trees can be arbitrarily deep for a while.
+ */
+template <class Key, class Data, class Balance = AvlBalance>
+class BalancedMap {
+public:
+
+    typedef BalancedNode<Key, Data, typename Balance::State> TreeNode;
+
+    BalancedMap() = default;
+    ~BalancedMap() { this->clear(); }
+
+    BalancedMap(const BalancedMap&) = delete;
+    BalancedMap& operator=(const BalancedMap&) = delete;
+
+    //---------------------------
+
+    bool add(const Key& key, const Data& data) {
+        return this->add({ key, data });
+    }
+
+    //---------------------------
+
+    bool add(const std::pair<Key, Data>& pair) {
+
+        TreeNode* parent = nullptr;
+        TreeNode** link = &pRoot;
+
+        while(*link) {
+
+            parent = *link;
+
+            if(pair.first < parent->key)
+                link = &parent->left;
+
+            else if(parent->key < pair.first)
+                link = &parent->right;
+
+            else {
+                Balance::accessed(pRoot, parent);
+                return false;
+            }
+        }
+
+        TreeNode* node = new (pAlloc.allocate()) TreeNode();
+
+        node->key = pair.first;
+        node->data = pair.second;
+        node->parent = parent;
+
+        *link = node;
+        ++pSize;
+
+        Balance::inserted(pRoot, node);
+
+        return true;
+    }
+
+    //---------------------------
+
+    Data* get(const Key& key) {
+
+        TreeNode* node = pRoot;
+        TreeNode* last = nullptr;
+
+        while(node) {
+
+            last = node;
+
+            if(key < node->key)
+                node = node->left;
+
+            else if(node->key < key)
+                node = node->right;
+
+            else
+                break;
+        }
+
+        if(last)
+            Balance::accessed(pRoot, last);
+
+        return node ? &node->data : nullptr;
+    }
+
+    //---------------------------
+
+    bool remove(const Key& key) {
+
+        TreeNode* node = pRoot;
+
+        while(node && (key < node->key || node->key < key))
+            node = key < node->key ? node->left : node->right;
+
+        if(!node)
+            return false;
+
+        TreeNode* child;
+        TreeNode* parent;
+        typename Balance::State removed;
+
+        if(!node->left || !node->right) {
+
+            child = node->left ? node->left : node->right;
+            parent = node->parent;
+            removed = node->state;
+
+            this->transplant(node, child);
+
+        } else {
+
+            // The successor leaves its own position and takes over the one of node, state included
+            TreeNode* next = node->right;
+            while(next->left)
+                next = next->left;
+
+            child = next->right;
+            removed = next->state;
+
+            if(next->parent == node)
+                parent = next;
+
+            else {
+                parent = next->parent;
+
+                this->transplant(next, child);
+
+                next->right = node->right;
+                next->right->parent = next;
+            }
+
+            this->transplant(node, next);
+
+            next->left = node->left;
+            next->left->parent = next;
+            next->state = node->state;
+        }
+
+        node->~TreeNode();
+        pAlloc.deallocate(node);
+        --pSize;
+
+        Balance::erased(pRoot, child, parent, removed);
+
+        return true;
+    }
+
+    //---------------------------
+
+    void clear() {
+
+        if(!pRoot)
+            return;
+
+        if(!std::is_trivially_destructible<TreeNode>::value) {
+
+            std::vector<TreeNode*> stack(1, pRoot);
+
+            while(!stack.empty()) {
+
+                TreeNode* node = stack.back();
+                stack.pop_back();
+
+                if(node->left) stack.push_back(node->left);
+                if(node->right) stack.push_back(node->right);
+
+                node->~TreeNode();
+            }
+        }
+
+        pAlloc.release();
+
+        pRoot = nullptr;
+        pSize = 0;
+    }
+
+    //---------------------------
+
+    size_t getSize() const {
+        return pSize;
+    }
+
+    //---------------------------
+
+    size_t getCountElement(Data data) const {
+
+        size_t counter = 0;
+
+        this->forEachNode([&](const TreeNode* node) {
+            if(node->data == data)
+                ++counter;
+        });
+
+        return counter;
+    }
+
+    //---------------------------
+
+    ///Same records as Map::getTree(). The nodes are owned by the map and stay valid until the next getTree() or clear()
+    std::vector<DataS<Key, Data>> getTree() {
+
+        std::vector<DataS<Key, Data>> data;
+        std::vector<std::pair<const TreeNode*, Node<Key, Data>*>> stack;
+
+        pExport.clear();
+        pExport.reserve(pSize); // the copies link to each other, so they must not move
+        data.reserve(pSize);
+
+        if(pRoot)
+            stack.push_back({ pRoot, nullptr });
+
+        // Preorder, the same order as exportNode()
+        while(!stack.empty()) {
+
+            const TreeNode* node = stack.back().first;
+            Node<Key, Data>* parent = stack.back().second;
+            stack.pop_back();
+
+            pExport.emplace_back();
+
+            Node<Key, Data>* copy = &pExport.back();
+            copy->node(node->key, node->data);
+            copy->parent = parent;
+
+            int level = 0, state = 0;
+
+            if(parent) {
+
+                level = data[parent - pExport.data()].level + 1;
+                state = node == node->parent->left ? 1 : 2;
+
+                (state == 1 ? parent->left : parent->right) = copy;
+            }
+
+            data.push_back({ copy, level, state });
+
+            if(node->right) stack.push_back({ node->right, copy });
+            if(node->left) stack.push_back({ node->left, copy });
+        }
+
+        // Children come after their parent, so heights can be filled in backwards
+        for(size_t i = pExport.size(); i-- > 0;) {
+
+            Node<Key, Data>& copy = pExport[i];
+
+            unsigned char hl = copy.left ? copy.left->height : 0,
+                          hr = copy.right ? copy.right->height : 0;
+
+            copy.height = (hl > hr ? hl : hr) + 1;
+        }
+
+        return data;
+    }
+
+    //---------------------------
+
+private:
+
+    TreeNode* pRoot = nullptr;
+    size_t pSize = 0;
+
+    NodePool<TreeNode> pAlloc;
+
+    std::vector<Node<Key, Data>> pExport;
+
+    //---------------------------
+
+    // Hangs child (possibly null) where node was
+    void transplant(TreeNode* node, TreeNode* child) {
+
+        if(!node->parent)
+            pRoot = child;
+
+        else if(node == node->parent->left)
+            node->parent->left = child;
+
+        else
+            node->parent->right = child;
+
+        if(child)
+            child->parent = node->parent;
+    }
+
+    //---------------------------
+
+    template <class Visitor>
+    void forEachNode(Visitor visit) const {
+
+        std::vector<const TreeNode*> stack;
+
+        if(pRoot)
+            stack.push_back(pRoot);
+
+        while(!stack.empty()) {
+
+            const TreeNode* node = stack.back();
+            stack.pop_back();
+
+            visit(node);
+
+            if(node->left) stack.push_back(node->left);
+            if(node->right) stack.push_back(node->right);
+        }
+    }
+};
+
+//---------------------------
+
+#endif // BALANCEDMAP_HPP_INCLUDED
+
+//---------------------------
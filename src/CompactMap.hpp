@@ -0,0 +1,462 @@
+//---------------------------
+
+#ifndef COMPACTMAP_HPP_INCLUDED
+#define COMPACTMAP_HPP_INCLUDED
+
+//---------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "Map.hpp"
+
+//---------------------------
+
+/*
+ * Key and links of one CompactMap node, everything a lookup touches.
+ * The low 29 bits of left and right are child indices, the top 3 bits of
+ * each hold half of the 6-bit AVL height (low half in left).
+ */
+template <class Key>
+struct CompactSlot {
+
+    uint32_t left;
+    uint32_t right;
+
+    Key key;
+};
+
+//---------------------------
+
+/*
+ * AVL tree with the same interface as Map, stored in flat arrays.
+ *
+ * Nodes are slots of a vector linked by 32-bit indices with the height packed
+ * into the spare link bits, the data lives in a separate array of its own so
+ * searches only pull keys and links into the cache. Without parent links the
+ * updates keep the path of link words they went through. A removal moves the
+ * last slot into the hole, so the arrays stay dense and never hold free slots.
+ * For Map<int, char> this is 13 bytes per element against a 32-byte Node.
+ */
+template <class Key, class Data>
+class CompactMap {
+public:
+
+    typedef CompactSlot<Key> Slot;
+
+    ///Largest number of elements the 29-bit indices can address
+    static constexpr size_t maxSize = (1u << 29) - 1;
+
+    CompactMap() = default;
+
+    CompactMap(const CompactMap&) = delete;
+    CompactMap& operator=(const CompactMap&) = delete;
+
+    //---------------------------
+
+    bool add(const Key& key, const Data& data) {
+        return this->add({ key, data });
+    }
+
+    //---------------------------
+
+    bool add(const std::pair<Key, Data>& pair) {
+
+        uint32_t* path[maxPathLength];
+        int depth = 0;
+
+        uint32_t* link = this->findLink(pair.first, path, depth);
+        if(link == nullptr)
+            return false;
+
+        if(pSlots.size() >= maxSize)
+            throw std::length_error("CompactMap: more elements than 32-bit links can address");
+
+        // Link words live inside the slots, so growing the array moves the path: it is walked again in the new one
+        if(pSlots.size() == pSlots.capacity()) {
+
+            pSlots.reserve(pSlots.size() < 16 ? 16 : pSlots.size() * 2);
+
+            depth = 0;
+            link = this->findLink(pair.first, path, depth);
+        }
+
+        uint32_t index = static_cast<uint32_t>(pSlots.size());
+
+        pSlots.push_back({ none, none, pair.first });
+        pData.push_back(pair.second);
+
+        setHeight(pSlots.back(), 1);
+        setChild(*link, index);
+
+        retrace(path, depth);
+
+        return true;
+    }
+
+    //---------------------------
+
+    Data* get(const Key& key) {
+
+        uint32_t index = pRoot;
+
+        while(index != none) {
+
+            const Slot& slot = pSlots[index];
+
+            if(key < slot.key)
+                index = child(slot.left);
+
+            else if(slot.key < key)
+                index = child(slot.right);
+
+            else
+                return &pData[index];
+        }
+
+        return nullptr;
+    }
+
+    //---------------------------
+
+    bool remove(const Key& key) {
+
+        uint32_t* path[maxPathLength];
+        uint32_t* link = &pRoot;
+        int depth = 0;
+
+        while(true) {
+
+            uint32_t index = child(*link);
+            if(index == none)
+                return false;
+
+            path[depth++] = link;
+
+            Slot& slot = pSlots[index];
+
+            if(key < slot.key)
+                link = &slot.left;
+
+            else if(slot.key < key)
+                link = &slot.right;
+
+            else
+                break;
+        }
+
+        uint32_t index = child(*link);
+        uint32_t freed = index;
+
+        if(child(pSlots[index].right) == none) {
+
+            // The left subtree is already balanced and just moves up
+            setChild(*link, child(pSlots[index].left));
+            --depth;
+
+        } else {
+
+            // The minimum of the right subtree hands its element over and is unlinked in its place
+            uint32_t* minLink = &pSlots[index].right;
+
+            while(child(pSlots[child(*minLink)].left) != none) {
+                path[depth++] = minLink;
+                minLink = &pSlots[child(*minLink)].left;
+            }
+
+            freed = child(*minLink);
+            setChild(*minLink, child(pSlots[freed].right));
+
+            pSlots[index].key = std::move(pSlots[freed].key);
+            pData[index] = std::move(pData[freed]);
+        }
+
+        retrace(path, depth);
+
+        this->releaseSlot(freed);
+
+        return true;
+    }
+
+    //---------------------------
+
+    void clear() {
+
+        pSlots.clear();
+        pData.clear();
+        pRoot = none;
+    }
+
+    //---------------------------
+
+    void reserve(size_t count) {
+
+        pSlots.reserve(count);
+        pData.reserve(count);
+    }
+
+    //---------------------------
+
+    size_t getSize() const {
+        return pSlots.size();
+    }
+
+    //---------------------------
+
+    ///Bytes held by the node arrays, including reserved capacity
+    size_t getMemoryUsage() const {
+        return pSlots.capacity() * sizeof(Slot) + pData.capacity() * sizeof(Data);
+    }
+
+    //---------------------------
+
+    size_t getCountElement(Data data) const {
+
+        size_t counter = 0;
+
+        for(size_t i = 0; i < pData.size(); ++i)
+            if(pData[i] == data)
+                ++counter;
+
+        return counter;
+    }
+
+    //---------------------------
+
+    ///Same records as Map::getTree(). The nodes are owned by the map and stay valid until the next getTree() or clear()
+    std::vector<DataS<Key, Data>> getTree() {
+
+        std::vector<DataS<Key, Data>> data;
+
+        pExport.clear();
+        pExport.reserve(pSlots.size()); // the copies link to each other, so they must not move
+        data.reserve(pSlots.size());
+
+        this->exportSlot(pRoot, 0, 0, data);
+
+        return data;
+    }
+
+    //---------------------------
+
+private:
+
+    static constexpr uint32_t indexMask = (1u << 29) - 1;
+    static constexpr uint32_t none = indexMask;
+
+    // AVL height is below 1.45 * log2(n + 2), far less than 64 for 2^29 elements
+    static constexpr int maxPathLength = 64;
+
+    std::vector<Slot> pSlots;
+    std::vector<Data> pData;
+
+    uint32_t pRoot = none;
+
+    std::vector<Node<Key, Data>> pExport;
+
+    //---------------------------
+
+    static uint32_t child(uint32_t link) {
+        return link & indexMask;
+    }
+
+    //---------------------------
+
+    static void setChild(uint32_t& link, uint32_t index) {
+        link = (link & ~indexMask) | index;
+    }
+
+    //---------------------------
+
+    static unsigned height(const Slot& slot) {
+        return (slot.left >> 29) | ((slot.right >> 29) << 3);
+    }
+
+    //---------------------------
+
+    static void setHeight(Slot& slot, unsigned height) {
+        slot.left = (slot.left & indexMask) | ((height & 7u) << 29);
+        slot.right = (slot.right & indexMask) | ((height >> 3) << 29);
+    }
+
+    //---------------------------
+
+    unsigned height(uint32_t index) const {
+        return index == none ? 0 : height(pSlots[index]);
+    }
+
+    //---------------------------
+
+    int balanceFactor(uint32_t index) const {
+        return static_cast<int>(height(child(pSlots[index].right))) - static_cast<int>(height(child(pSlots[index].left)));
+    }
+
+    //---------------------------
+
+    void fixHeight(uint32_t index) {
+
+        unsigned hl = height(child(pSlots[index].left)),
+                 hr = height(child(pSlots[index].right));
+
+        setHeight(pSlots[index], (hl > hr ? hl : hr) + 1);
+    }
+
+    //---------------------------
+
+    // The empty link where key belongs, with the links above it in path. Null if key is already there
+    uint32_t* findLink(const Key& key, uint32_t** path, int& depth) {
+
+        uint32_t* link = &pRoot;
+
+        while(child(*link) != none) {
+
+            Slot& slot = pSlots[child(*link)];
+            path[depth++] = link;
+
+            if(key < slot.key)
+                link = &slot.left;
+
+            else if(slot.key < key)
+                link = &slot.right;
+
+            else
+                return nullptr;
+        }
+
+        return link;
+    }
+
+    //---------------------------
+
+    uint32_t rotateRight(uint32_t p) {
+
+        uint32_t q = child(pSlots[p].left);
+
+        setChild(pSlots[p].left, child(pSlots[q].right));
+        setChild(pSlots[q].right, p);
+
+        this->fixHeight(p);
+        this->fixHeight(q);
+
+        return q;
+    }
+
+    //---------------------------
+
+    uint32_t rotateLeft(uint32_t q) {
+
+        uint32_t p = child(pSlots[q].right);
+
+        setChild(pSlots[q].right, child(pSlots[p].left));
+        setChild(pSlots[p].left, q);
+
+        this->fixHeight(q);
+        this->fixHeight(p);
+
+        return p;
+    }
+
+    //---------------------------
+
+    uint32_t balance(uint32_t p) {
+
+        this->fixHeight(p);
+
+        if(this->balanceFactor(p) == 2) {
+            if(this->balanceFactor(child(pSlots[p].right)) < 0)
+                setChild(pSlots[p].right, rotateRight(child(pSlots[p].right)));
+            return rotateLeft(p);
+        }
+
+        if(this->balanceFactor(p) == -2) {
+            if(this->balanceFactor(child(pSlots[p].left)) > 0)
+                setChild(pSlots[p].left, rotateLeft(child(pSlots[p].left)));
+            return rotateRight(p);
+        }
+
+        return p;
+    }
+
+    //---------------------------
+
+    void retrace(uint32_t* path[], int depth) {
+
+        while(depth > 0) {
+
+            uint32_t* link = path[--depth];
+            uint32_t index = child(*link);
+
+            unsigned oldHeight = height(pSlots[index]);
+
+            index = balance(index);
+            setChild(*link, index);
+
+            if(height(pSlots[index]) == oldHeight)
+                break;
+        }
+    }
+
+    //---------------------------
+
+    // Fills the unlinked slot freed with the last one, so the arrays shrink by one
+    void releaseSlot(uint32_t freed) {
+
+        uint32_t last = static_cast<uint32_t>(pSlots.size() - 1);
+
+        if(freed != last) {
+
+            const Key& key = pSlots[last].key;
+            uint32_t* link = &pRoot;
+
+            while(child(*link) != last) {
+
+                const Slot& slot = pSlots[child(*link)];
+                link = key < slot.key ? &pSlots[child(*link)].left : &pSlots[child(*link)].right;
+            }
+
+            pSlots[freed] = std::move(pSlots[last]);
+            pData[freed] = std::move(pData[last]);
+
+            setChild(*link, freed);
+        }
+
+        pSlots.pop_back();
+        pData.pop_back();
+    }
+
+    //---------------------------
+
+    Node<Key, Data>* exportSlot(uint32_t index, int level, int state, std::vector<DataS<Key, Data>>& data) {
+
+        if(index == none)
+            return nullptr;
+
+        pExport.emplace_back();
+
+        Node<Key, Data>* copy = &pExport.back();
+        copy->node(pSlots[index].key, pData[index]);
+        copy->height = static_cast<unsigned char>(height(pSlots[index]));
+
+        data.push_back({ copy, level, state });
+
+        copy->left = exportSlot(child(pSlots[index].left), level + 1, 1, data);
+        copy->right = exportSlot(child(pSlots[index].right), level + 1, 2, data);
+
+        if(copy->left)
+            copy->left->parent = copy;
+
+        if(copy->right)
+            copy->right->parent = copy;
+
+        return copy;
+    }
+};
+
+//---------------------------
+
+#endif // COMPACTMAP_HPP_INCLUDED
+
+//---------------------------
@@ -0,0 +1,633 @@
+//---------------------------
+
+#ifndef CONCURRENTMAP_HPP_INCLUDED
+#define CONCURRENTMAP_HPP_INCLUDED
+
+//---------------------------
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Map.hpp"
+#include "NodePool.hpp"
+
+//---------------------------
+
+template <class Key, class Data>
+struct ConcurrentNode {
+
+    Key key;
+    Data data;
+
+    unsigned char height = 1;
+
+    ConcurrentNode* left = nullptr;
+    ConcurrentNode* right = nullptr;
+
+    uint64_t stamp = 0; // write that created the node, only that write may still change it
+};
+
+//---------------------------
+
+/*
+ * AVL map for many readers and one writer at a time.
+ *
+ * A published tree is never modified. A writer (serialised by a mutex) copies
+ * the path it changes, then swaps the root pointer, so readers only load the
+ * root and walk without locks. Replaced nodes are retired with the current
+ * epoch and freed once every reader that could still see them has left:
+ * readers announce the epoch they started in through a slot. The slots come
+ * in blocks of readersPerBlock; when every slot is taken another block is chained
+ * on, so any number of snapshots may be alive at once. Blocks are only freed
+ * with the map.
+ */
+template <class Key, class Data>
+class ConcurrentMap {
+
+    struct ReaderSlot;
+
+public:
+
+    typedef ConcurrentNode<Key, Data> CNode;
+
+    static constexpr size_t readersPerBlock = 64; // slots of one reader block, not a limit
+
+    class Snapshot;
+
+    ConcurrentMap() = default;
+    ~ConcurrentMap() { this->destroy(); }
+
+    ConcurrentMap(const ConcurrentMap&) = delete;
+    ConcurrentMap& operator=(const ConcurrentMap&) = delete;
+
+    //---------------------------
+
+    bool add(const Key& key, const Data& data) {
+        return this->add({ key, data });
+    }
+
+    //---------------------------
+
+    bool add(const std::pair<Key, Data>& pair) {
+
+        std::lock_guard<std::mutex> lock(pWriteLock);
+        ++pStamp;
+
+        bool added = false;
+        CNode* root = this->insert(pRoot.load(std::memory_order_relaxed), pair, added);
+
+        if(added)
+            this->publish(root);
+
+        return added;
+    }
+
+    //---------------------------
+
+    bool remove(const Key& key) {
+
+        std::lock_guard<std::mutex> lock(pWriteLock);
+        ++pStamp;
+
+        bool removed = false;
+        CNode* root = this->erase(pRoot.load(std::memory_order_relaxed), key, removed);
+
+        if(removed)
+            this->publish(root);
+
+        return removed;
+    }
+
+    //---------------------------
+
+    void clear() {
+
+        std::lock_guard<std::mutex> lock(pWriteLock);
+        ++pStamp; // every node below was published, so all of them wait for the readers
+
+        CNode* stack[maxPathLength];
+        int depth = 0;
+
+        if(CNode* root = pRoot.load(std::memory_order_relaxed))
+            stack[depth++] = root;
+
+        while(depth > 0) {
+
+            CNode* node = stack[--depth];
+
+            if(node->left) stack[depth++] = node->left;
+            if(node->right) stack[depth++] = node->right;
+
+            this->retire(node);
+        }
+
+        this->publish(nullptr);
+    }
+
+    //---------------------------
+
+    ///Copies the data of key into data, lock-free
+    bool get(const Key& key, Data& data) const {
+
+        Snapshot snapshot = this->snapshot();
+        const Data* found = snapshot.get(key);
+
+        if(!found)
+            return false;
+
+        data = *found;
+        return true;
+    }
+
+    //---------------------------
+
+    size_t getCountElement(Data data) const {
+        return this->snapshot().getCountElement(data);
+    }
+
+    //---------------------------
+
+    ///Pins the current version, it stays readable (and its memory alive) until the snapshot is destroyed
+    Snapshot snapshot() const {
+
+        ReaderSlot* slot = this->pin();
+        return Snapshot(this, slot, pRoot.load(std::memory_order_seq_cst));
+    }
+
+    //---------------------------
+
+    class Snapshot {
+    public:
+
+        Snapshot(Snapshot&& other) : pMap(other.pMap), pSlot(other.pSlot), pRoot(other.pRoot), pExport(std::move(other.pExport)) {
+            other.pMap = nullptr;
+        }
+
+        ~Snapshot() {
+            if(pMap)
+                pMap->unpin(pSlot);
+        }
+
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator=(const Snapshot&) = delete;
+        Snapshot& operator=(Snapshot&&) = delete;
+
+        //---------------------------
+
+        const Data* get(const Key& key) const {
+
+            const CNode* node = pRoot;
+
+            while(node) {
+
+                if(key < node->key)
+                    node = node->left;
+
+                else if(node->key < key)
+                    node = node->right;
+
+                else
+                    return &node->data;
+            }
+
+            return nullptr;
+        }
+
+        //---------------------------
+
+        size_t getCountElement(Data data) const {
+
+            const CNode* stack[maxPathLength];
+            int depth = 0;
+            size_t counter = 0;
+
+            if(pRoot)
+                stack[depth++] = pRoot;
+
+            while(depth > 0) {
+
+                const CNode* node = stack[--depth];
+
+                if(node->data == data)
+                    ++counter;
+
+                if(node->left) stack[depth++] = node->left;
+                if(node->right) stack[depth++] = node->right;
+            }
+
+            return counter;
+        }
+
+        //---------------------------
+
+        ///Same records as Map::getTree(). The nodes are copies owned by the snapshot,
+        ///valid while it lives and until the next getTree() on it
+        std::vector<DataS<Key, Data>> getTree() {
+            return exportTree(pRoot, pExport);
+        }
+
+        //---------------------------
+
+    private:
+
+        friend class ConcurrentMap;
+
+        Snapshot(const ConcurrentMap* map, ReaderSlot* slot, const CNode* root) : pMap(map), pSlot(slot), pRoot(root) {}
+
+        const ConcurrentMap* pMap;
+        ReaderSlot* pSlot;
+        const CNode* pRoot;
+
+        std::vector<Node<Key, Data>> pExport;
+    };
+
+    //---------------------------
+
+private:
+
+    static constexpr int maxPathLength = 64;
+
+    struct alignas(64) ReaderSlot {
+        std::atomic<uint64_t> epoch{0}; // 0 - free
+    };
+
+    struct ReaderBlock {
+        ReaderSlot slots[readersPerBlock];
+        std::atomic<ReaderBlock*> next{nullptr};
+
+        ~ReaderBlock() { delete next.load(std::memory_order_relaxed); }
+    };
+
+    std::atomic<CNode*> pRoot{nullptr};
+    std::atomic<uint64_t> pEpoch{1};
+
+    mutable ReaderBlock pReaders;
+
+    // Writer state, guarded by pWriteLock
+    std::mutex pWriteLock;
+    uint64_t pStamp = 0;
+
+    NodePool<CNode> pAlloc;
+    std::deque<std::pair<uint64_t, CNode*>> pRetired;
+
+    //---------------------------
+
+    // Scans every block once from the slot of the thread, a full chain gets a new block (the losing thread of a race drops its own)
+    ReaderSlot* pin() const {
+
+        size_t start = std::hash<std::thread::id>()(std::this_thread::get_id()) % readersPerBlock;
+
+        for(ReaderBlock* block = &pReaders; ; ) {
+
+            for(size_t i = 0; i < readersPerBlock; ++i) {
+
+                ReaderSlot& slot = block->slots[(start + i) % readersPerBlock];
+
+                if(this->announce(slot))
+                    return &slot;
+            }
+
+            ReaderBlock* next = block->next.load(std::memory_order_seq_cst);
+
+            if(!next) {
+
+                ReaderBlock* fresh = new ReaderBlock();
+
+                if(block->next.compare_exchange_strong(next, fresh, std::memory_order_seq_cst))
+                    next = fresh;
+                else
+                    delete fresh;
+            }
+
+            block = next;
+        }
+    }
+
+    //---------------------------
+
+    bool announce(ReaderSlot& slot) const {
+
+        uint64_t epoch = pEpoch.load(std::memory_order_seq_cst);
+        uint64_t expected = 0;
+
+        if(!slot.epoch.compare_exchange_strong(expected, epoch, std::memory_order_seq_cst))
+            return false;
+
+        // The announcement only counts if the epoch did not move meanwhile
+        uint64_t current;
+        while((current = pEpoch.load(std::memory_order_seq_cst)) != epoch) {
+            slot.epoch.store(current, std::memory_order_seq_cst);
+            epoch = current;
+        }
+
+        return true;
+    }
+
+    //---------------------------
+
+    void unpin(ReaderSlot* slot) const {
+        slot->epoch.store(0, std::memory_order_release);
+    }
+
+    //---------------------------
+
+    // Swaps in the new root, closes the epoch of everything retired so far and frees what no reader can reach
+    void publish(CNode* root) {
+
+        pRoot.store(root, std::memory_order_seq_cst);
+        pEpoch.fetch_add(1, std::memory_order_seq_cst);
+
+        uint64_t oldest = pEpoch.load(std::memory_order_seq_cst);
+
+        for(const ReaderBlock* block = &pReaders; block; block = block->next.load(std::memory_order_seq_cst)) {
+
+            for(size_t i = 0; i < readersPerBlock; ++i) {
+
+                uint64_t epoch = block->slots[i].epoch.load(std::memory_order_seq_cst);
+                if(epoch != 0 && epoch < oldest)
+                    oldest = epoch;
+            }
+        }
+
+        while(!pRetired.empty() && pRetired.front().first < oldest) {
+            this->release(pRetired.front().second);
+            pRetired.pop_front();
+        }
+    }
+
+    //---------------------------
+
+    CNode* createNode(const Key& key, const Data& data) {
+
+        CNode* node = new (pAlloc.allocate()) CNode();
+
+        node->key = key;
+        node->data = data;
+        node->stamp = pStamp;
+
+        return node;
+    }
+
+    //---------------------------
+
+    void release(CNode* node) {
+        node->~CNode();
+        pAlloc.deallocate(node);
+    }
+
+    //---------------------------
+
+    // Nodes of the running write were never visible and go right away, published ones wait for the readers
+    void retire(CNode* node) {
+
+        if(node->stamp == pStamp)
+            this->release(node);
+        else
+            pRetired.push_back({ pEpoch.load(std::memory_order_relaxed), node });
+    }
+
+    //---------------------------
+
+    // Returns a node the running write may change: node itself if this write created it, a fresh copy otherwise
+    CNode* own(CNode* node) {
+
+        if(node->stamp == pStamp)
+            return node;
+
+        CNode* copy = this->createNode(node->key, node->data);
+
+        copy->height = node->height;
+        copy->left = node->left;
+        copy->right = node->right;
+
+        this->retire(node);
+
+        return copy;
+    }
+
+    //---------------------------
+
+    static unsigned char height(const CNode* node) {
+        return node ? node->height : 0;
+    }
+
+    //---------------------------
+
+    static void fixHeight(CNode* node) {
+
+        unsigned char hl = height(node->left),
+                      hr = height(node->right);
+
+        node->height = (hl > hr ? hl : hr) + 1;
+    }
+
+    //---------------------------
+
+    // p and its left child must be owned
+    static CNode* rotateRight(CNode* p) {
+
+        CNode* q = p->left;
+
+        p->left = q->right;
+        q->right = p;
+
+        fixHeight(p);
+        fixHeight(q);
+
+        return q;
+    }
+
+    //---------------------------
+
+    // q and its right child must be owned
+    static CNode* rotateLeft(CNode* q) {
+
+        CNode* p = q->right;
+
+        q->right = p->left;
+        p->left = q;
+
+        fixHeight(q);
+        fixHeight(p);
+
+        return p;
+    }
+
+    //---------------------------
+
+    // p is owned, the children taking part in a rotation are copied first
+    CNode* balance(CNode* p) {
+
+        fixHeight(p);
+
+        int factor = height(p->right) - height(p->left);
+
+        if(factor == 2) {
+
+            p->right = this->own(p->right);
+
+            if(height(p->right->right) < height(p->right->left)) {
+                p->right->left = this->own(p->right->left);
+                p->right = rotateRight(p->right);
+            }
+
+            return rotateLeft(p);
+        }
+
+        if(factor == -2) {
+
+            p->left = this->own(p->left);
+
+            if(height(p->left->left) < height(p->left->right)) {
+                p->left->right = this->own(p->left->right);
+                p->left = rotateLeft(p->left);
+            }
+
+            return rotateRight(p);
+        }
+
+        return p;
+    }
+
+    //---------------------------
+
+    CNode* insert(CNode* node, const std::pair<Key, Data>& item, bool& added) {
+
+        if(!node) {
+            added = true;
+            return this->createNode(item.first, item.second);
+        }
+
+        if(item.first < node->key) {
+
+            CNode* left = this->insert(node->left, item, added);
+            if(!added)
+                return node;
+
+            node = this->own(node);
+            node->left = left;
+
+        } else if(node->key < item.first) {
+
+            CNode* right = this->insert(node->right, item, added);
+            if(!added)
+                return node;
+
+            node = this->own(node);
+            node->right = right;
+
+        } else
+            return node;
+
+        return this->balance(node);
+    }
+
+    //---------------------------
+
+    CNode* erase(CNode* node, const Key& key, bool& removed) {
+
+        if(!node)
+            return nullptr;
+
+        if(key < node->key) {
+
+            CNode* left = this->erase(node->left, key, removed);
+            if(!removed)
+                return node;
+
+            node = this->own(node);
+            node->left = left;
+
+        } else if(node->key < key) {
+
+            CNode* right = this->erase(node->right, key, removed);
+            if(!removed)
+                return node;
+
+            node = this->own(node);
+            node->right = right;
+
+        } else {
+
+            removed = true;
+
+            CNode* left = node->left;
+            CNode* right = node->right;
+
+            this->retire(node);
+
+            if(!right)
+                return left;
+
+            CNode* min = nullptr;
+            right = this->eraseMin(right, min);
+
+            node = this->createNode(min->key, min->data);
+            node->left = left;
+            node->right = right;
+
+            this->retire(min);
+        }
+
+        return this->balance(node);
+    }
+
+    //---------------------------
+
+    CNode* eraseMin(CNode* node, CNode*& min) {
+
+        if(!node->left) {
+            min = node;
+            return node->right;
+        }
+
+        CNode* left = this->eraseMin(node->left, min);
+
+        node = this->own(node);
+        node->left = left;
+
+        return this->balance(node);
+    }
+
+    //---------------------------
+
+    // No readers may be left at this point
+    void destroy() {
+
+        CNode* stack[maxPathLength];
+        int depth = 0;
+
+        if(CNode* root = pRoot.load(std::memory_order_relaxed))
+            stack[depth++] = root;
+
+        while(depth > 0) {
+
+            CNode* node = stack[--depth];
+
+            if(node->left) stack[depth++] = node->left;
+            if(node->right) stack[depth++] = node->right;
+
+            node->~CNode();
+        }
+
+        for(size_t i = 0; i < pRetired.size(); ++i)
+            pRetired[i].second->~CNode();
+
+        pRetired.clear();
+        pAlloc.release();
+    }
+};
+
+//---------------------------
+
+#endif // CONCURRENTMAP_HPP_INCLUDED
+
+//---------------------------
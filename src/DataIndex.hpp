@@ -0,0 +1,120 @@
+//---------------------------
+
+#ifndef DATAINDEX_HPP_INCLUDED
+#define DATAINDEX_HPP_INCLUDED
+
+//---------------------------
+
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+//---------------------------
+
+///True when DataIndex can count Data: one-byte integers, or a std::hash and == for it.
+///Map turns its index on by default only then, other data is counted by walking the tree
+template <class Data, class = void>
+struct CanIndexData : std::integral_constant<bool, std::is_integral<Data>::value && sizeof(Data) == 1> {};
+
+template <class Data>
+struct CanIndexData<Data, decltype(void(std::hash<Data>()(std::declval<const Data&>())),
+                                   void(std::declval<const Data&>() == std::declval<const Data&>()))> : std::true_type {};
+
+//---------------------------
+
+/*
+ * Occurrence counter per data value, kept up to date by Map on every insert
+ * and removal so Map::getCountElement() is a single lookup.
+ * One-byte integral values (the char of the demo) use a flat 256-entry table,
+ * everything else a hash map.
+ */
+template <class Data, bool Enabled = true, bool Byte = std::is_integral<Data>::value && sizeof(Data) == 1>
+class DataIndex {
+public:
+
+    static constexpr bool enabled = true;
+
+    void insert(const Data& data) {
+        ++pCounts[data];
+    }
+
+    void erase(const Data& data) {
+
+        auto it = pCounts.find(data);
+        if(it != pCounts.end() && --it->second == 0)
+            pCounts.erase(it);
+    }
+
+    size_t count(const Data& data) const {
+
+        auto it = pCounts.find(data);
+        return it == pCounts.end() ? 0 : it->second;
+    }
+
+    void clear() {
+        pCounts.clear();
+    }
+
+private:
+
+    std::unordered_map<Data, size_t> pCounts;
+};
+
+//---------------------------
+
+template <class Data>
+class DataIndex<Data, true, true> {
+public:
+
+    static constexpr bool enabled = true;
+
+    void insert(const Data& data) {
+        ++pCounts[slot(data)];
+    }
+
+    void erase(const Data& data) {
+        --pCounts[slot(data)];
+    }
+
+    size_t count(const Data& data) const {
+        return pCounts[slot(data)];
+    }
+
+    void clear() {
+        for(size_t i = 0; i < 256; ++i)
+            pCounts[i] = 0;
+    }
+
+private:
+
+    size_t pCounts[256] = {};
+
+    static size_t slot(const Data& data) {
+        return static_cast<unsigned char>(data);
+    }
+};
+
+//---------------------------
+
+template <class Data, bool Byte>
+class DataIndex<Data, false, Byte> {
+public:
+
+    static constexpr bool enabled = false;
+
+    void insert(const Data&) {}
+    void erase(const Data&) {}
+    void clear() {}
+
+    size_t count(const Data&) const {
+        return 0;
+    }
+};
+
+//---------------------------
+
+#endif // DATAINDEX_HPP_INCLUDED
+
+//---------------------------
@@ -0,0 +1,207 @@
+//---------------------------
+
+#ifndef FROZENMAP_HPP_INCLUDED
+#define FROZENMAP_HPP_INCLUDED
+
+//---------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    #include <immintrin.h>
+#endif
+
+//---------------------------
+
+/*
+ * Immutable snapshot of a Map (see Map::freeze()).
+ *
+ * Keys are stored in Eytzinger (BFS) order: the root in slot 1, the children
+ * of slot k in slots 2k and 2k+1. Data lives in a parallel array with the same
+ * indexing. The search is branchless and prefetches the cache line holding the
+ * descendants four levels below, for signed 32/64-bit keys the first four
+ * levels (slots 1..15, one cache line) are resolved with one SIMD rank count.
+ */
+template <class Key, class Data>
+class FrozenMap {
+public:
+
+    FrozenMap() = default;
+
+    //---------------------------
+
+    ///keys must be sorted and unique, data[i] belongs to keys[i]
+    FrozenMap(const std::vector<Key>& keys, const std::vector<Data>& data) {
+
+        pSize = keys.size();
+
+        pKeys.resize(pSize + 1);
+        pData.resize(pSize + 1);
+
+        size_t i = 0;
+        this->fill(1, keys, data, i);
+    }
+
+    //---------------------------
+
+    const Data* get(const Key& key) const {
+
+        size_t k = this->lowerBound(key);
+
+        if(k == 0 || key < pKeys[k])
+            return nullptr;
+
+        return &pData[k];
+    }
+
+    //---------------------------
+
+    bool contains(const Key& key) const {
+        return this->get(key) != nullptr;
+    }
+
+    //---------------------------
+
+    size_t getSize() const {
+        return pSize;
+    }
+
+    //---------------------------
+
+private:
+
+    // Keys per cache line: slot k * lineKeys is where the descendants 4 (for 4-byte keys) levels below k start
+    static constexpr size_t lineKeys = 64 / sizeof(Key) > 0 ? 64 / sizeof(Key) : 1;
+
+    std::vector<Key> pKeys;
+    std::vector<Data> pData;
+
+    size_t pSize = 0;
+
+    //---------------------------
+
+    void fill(size_t k, const std::vector<Key>& keys, const std::vector<Data>& data, size_t& i) {
+
+        if(k > pSize)
+            return;
+
+        this->fill(2 * k, keys, data, i);
+
+        pKeys[k] = keys[i];
+        pData[k] = data[i];
+        ++i;
+
+        this->fill(2 * k + 1, keys, data, i);
+    }
+
+    //---------------------------
+
+    // Slot of the first key not less than key, 0 if there is none
+    size_t lowerBound(const Key& key) const {
+
+        const Key* keys = pKeys.data();
+        size_t k = this->topLevels(key);
+
+        while(k <= pSize) {
+#if defined(__GNUC__)
+            __builtin_prefetch(keys + k * lineKeys);
+#endif
+            k = 2 * k + (keys[k] < key);
+        }
+
+        // Undo the right turns taken after the last left turn
+#if defined(__GNUC__)
+        k >>= __builtin_ffsll(static_cast<long long>(~k));
+#else
+        while(k & 1)
+            k >>= 1;
+        k >>= 1;
+#endif
+
+        return k;
+    }
+
+    //---------------------------
+
+    // Signed 32-bit keys with SSE2/AVX2 and signed 64-bit keys with AVX2 take the SIMD path
+#if defined(__AVX2__)
+    static constexpr bool simdKeys = std::is_integral<Key>::value && std::is_signed<Key>::value && (sizeof(Key) == 4 || sizeof(Key) == 8);
+#elif defined(__SSE2__)
+    static constexpr bool simdKeys = std::is_integral<Key>::value && std::is_signed<Key>::value && sizeof(Key) == 4;
+#else
+    static constexpr bool simdKeys = false;
+#endif
+
+    //---------------------------
+
+    // Descends the first four levels at once when the SIMD path applies, returns the slot to continue from
+    size_t topLevels(const Key& key) const {
+
+        if constexpr(simdKeys) {
+            if(pSize >= 15) {
+
+                // Slot 0 is unused, so the block of slots 0..15 is compared and bit 0 is dropped
+                unsigned mask = lessMask(key, pKeys.data());
+                return 16 + static_cast<size_t>(__builtin_popcount(mask & ~1u));
+            }
+        }
+
+        return 1;
+    }
+
+    //---------------------------
+
+    // Bit i is set when keys[i] < key for i in 0..15
+    static unsigned lessMask(const Key& key, const Key* keys) {
+
+#if defined(__AVX2__)
+        if constexpr(sizeof(Key) == 4) {
+
+            __m256i k = _mm256_set1_epi32(static_cast<int32_t>(key)),
+                    a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys)),
+                    b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + 8));
+
+            unsigned lo = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(k, a)))),
+                     hi = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(k, b))));
+
+            return lo | (hi << 8);
+
+        } else {
+
+            __m256i k = _mm256_set1_epi64x(static_cast<long long>(key));
+            unsigned mask = 0;
+
+            for(int i = 0; i < 4; ++i) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i * 4));
+                mask |= static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(k, v)))) << (i * 4);
+            }
+
+            return mask;
+        }
+#elif defined(__SSE2__)
+        __m128i k = _mm_set1_epi32(static_cast<int32_t>(key));
+        unsigned mask = 0;
+
+        for(int i = 0; i < 4; ++i) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i * 4));
+            mask |= static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(k, v)))) << (i * 4);
+        }
+
+        return mask;
+#else
+        (void)key;
+        (void)keys;
+        return 0;
+#endif
+    }
+};
+
+//---------------------------
+
+#endif // FROZENMAP_HPP_INCLUDED
+
+//---------------------------
@@ -0,0 +1,149 @@
+//---------------------------
+
+#ifndef HOTCACHE_HPP_INCLUDED
+#define HOTCACHE_HPP_INCLUDED
+
+//---------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+//---------------------------
+
+///What Map::cacheStats() reports, counted since construction or the last resetCacheStats()
+struct HotCacheCounters {
+
+    uint64_t hits = 0,
+             misses = 0;
+};
+
+//---------------------------
+
+/*
+ * Two-way set-associative cache of nodes in front of the tree walk of Map::get().
+ *
+ * Every key hashes to one set of two entries. A node found by the tree walk
+ * goes into the second way, a hit there swaps it into the first one, so a
+ * key must be asked for twice before it can push a hot key out and a stream
+ * of cold misses only churns the second way. Entries keep the upper hash bits
+ * as a tag and the node is only read when the tag matches. Nodes that leave
+ * the map have to be erased before they are freed. With Slots = 0 every call
+ * is empty and the map carries no state.
+ */
+template <class TNode, size_t Slots>
+class HotCache {
+public:
+
+    static_assert(Slots >= 2 && (Slots & (Slots - 1)) == 0, "HotCache: the slot count must be a power of two");
+
+    static constexpr bool enabled = true;
+
+    template <class Key>
+    TNode* find(const Key& key) {
+
+        uint64_t hash = mix(key);
+        Entry* set = &pEntries[index(hash)];
+
+        for(int way = 0; way < 2; ++way) {
+
+            TNode* node = set[way].node;
+
+            if(node && set[way].tag == tag(hash) && !(key < node->key) && !(node->key < key)) {
+
+                if(way == 1)
+                    std::swap(set[0], set[1]);
+
+                ++pCounters.hits;
+                return node;
+            }
+        }
+
+        ++pCounters.misses;
+        return nullptr;
+    }
+
+    void insert(TNode* node) {
+
+        uint64_t hash = mix(node->key);
+        pEntries[index(hash) + 1] = { node, tag(hash) };
+    }
+
+    ///Forgets node if its set still holds it
+    void erase(const TNode* node) {
+
+        Entry* set = &pEntries[index(mix(node->key))];
+
+        for(int way = 0; way < 2; ++way)
+            if(set[way].node == node)
+                set[way] = Entry();
+    }
+
+    ///Empties every entry, the counters go on
+    void clear() {
+        for(size_t i = 0; i < Slots; ++i)
+            pEntries[i] = Entry();
+    }
+
+    HotCacheCounters get() const {
+        return pCounters;
+    }
+
+    void reset() {
+        pCounters = HotCacheCounters();
+    }
+
+private:
+
+    struct Entry {
+        TNode* node = nullptr;
+        uint32_t tag = 0;
+    };
+
+    Entry pEntries[Slots];
+    HotCacheCounters pCounters;
+
+    // std::hash of integers is the identity, the multiply spreads runs of keys over the sets
+    template <class Key>
+    static uint64_t mix(const Key& key) {
+        return static_cast<uint64_t>(std::hash<Key>()(key)) * 0x9E3779B97F4A7C15ull;
+    }
+
+    // First entry of the set, the sets take the bits just below the tag
+    static size_t index(uint64_t hash) {
+        return static_cast<size_t>(hash >> 16) & (Slots - 2);
+    }
+
+    static uint32_t tag(uint64_t hash) {
+        return static_cast<uint32_t>(hash >> 32);
+    }
+};
+
+//---------------------------
+
+template <class TNode>
+class HotCache<TNode, 0> {
+public:
+
+    static constexpr bool enabled = false;
+
+    template <class Key>
+    TNode* find(const Key&) { return nullptr; }
+
+    void insert(TNode*) {}
+    void erase(const TNode*) {}
+    void clear() {}
+
+    HotCacheCounters get() const {
+        return HotCacheCounters();
+    }
+
+    void reset() {}
+};
+
+//---------------------------
+
+#endif // HOTCACHE_HPP_INCLUDED
+
+//---------------------------
@@ -6,10 +6,26 @@
 //---------------------------
 
 #include <utility>
+#include <algorithm>
 #include <iomanip>
-
-#include <map>
-#include <queue>
+#include <iterator>
+#include <iostream>
+#include <string>
+#include <new>
+#include <type_traits>
+#include <thread>
+
+#include <vector>
+#include <cstdint>
+
+#include "NodePool.hpp"
+#include "FrozenMap.hpp"
+#include "DataIndex.hpp"
+#include "TextSink.hpp"
+#include "MapFile.hpp"
+#include "MapStats.hpp"
+#include "TreeOrder.hpp"
+#include "HotCache.hpp"
 
 //---------------------------
 
@@ -23,8 +39,15 @@ struct Node {
 
     Node* left = nullptr;
     Node* right = nullptr;
+    Node* parent = nullptr;
+
+    Node() = default;
 
-    void node(Key key, Data data) { this->key = key; this->data = data; left=right=0; height= 1; }
+    ///Builds the key from key and the data from args in place
+    template <class K, class... Args>
+    Node(std::piecewise_construct_t, K&& key, Args&&... args) : key(std::forward<K>(key)), data(std::forward<Args>(args)...), height(1) {}
+
+    void node(const Key& key, const Data& data) { this->key = key; this->data = data; left=right=parent=0; height= 1; }
 };
 
 //---------------------------
@@ -38,367 +61,2157 @@ struct DataS {
 
 //---------------------------
 
+///Tree layout as parallel arrays, entry i is one node: its key, data, depth and slot on that level counted
+///from the left (the path from the root read as a binary number, left 0 and right 1). Offsets are 64-bit,
+///a tree is at most maxPathLength (64) levels deep, so the deepest offset still fits
+template <class Key, class Data>
+struct TreeLayout {
+
+    std::vector<Key> keys;
+    std::vector<Data> data;
+    std::vector<int> levels;
+    std::vector<uint64_t> offsets;
+
+    int levelCount = 0;
+
+    size_t size() const {
+        return keys.size();
+    }
+
+    ///Empties the arrays and keeps their memory for the next export
+    void clear() {
+        keys.clear();
+        data.clear();
+        levels.clear();
+        offsets.clear();
+        levelCount = 0;
+    }
+
+    void push(const Key& key, const Data& value, int level, uint64_t offset) {
+        keys.push_back(key);
+        data.push_back(value);
+        levels.push_back(level);
+        offsets.push_back(offset);
+
+        if(level >= levelCount)
+            levelCount = level + 1;
+    }
+};
+
+//---------------------------
+
+template <class TNode, class Key, class Data>
+Node<Key, Data>* exportNode(const TNode* node, int level, int state, std::vector<Node<Key, Data>>& nodes, std::vector<DataS<Key, Data>>& data) {
+
+    if(!node)
+        return nullptr;
+
+    nodes.emplace_back();
+
+    Node<Key, Data>* copy = &nodes.back();
+    copy->node(node->key, node->data);
+    copy->height = node->height;
+
+    data.push_back({ copy, level, state });
+
+    copy->left = exportNode(node->left, level + 1, 1, nodes, data);
+    copy->right = exportNode(node->right, level + 1, 2, nodes, data);
+
+    if(copy->left)
+        copy->left->parent = copy;
+
+    if(copy->right)
+        copy->right->parent = copy;
+
+    return copy;
+}
+
+//---------------------------
+
+///getTree() records for trees of other node types: the nodes are copied into nodes (which owns them from then on)
+template <class TNode, class Key, class Data>
+std::vector<DataS<Key, Data>> exportTree(const TNode* root, std::vector<Node<Key, Data>>& nodes) {
+
+    size_t count = 0;
+    const TNode* stack[64];
+    int depth = 0;
+
+    if(root)
+        stack[depth++] = root;
+
+    while(depth > 0) {
+
+        const TNode* node = stack[--depth];
+        ++count;
+
+        if(node->left) stack[depth++] = node->left;
+        if(node->right) stack[depth++] = node->right;
+    }
+
+    std::vector<DataS<Key, Data>> data;
+
+    nodes.clear();
+    nodes.reserve(count); // the copies link to each other, so they must not move
+    data.reserve(count);
+
+    exportNode(root, 0, 0, nodes, data);
+
+    return data;
+}
+
+//---------------------------
+
+// True when K can be looked up against Key with operator< in both directions without building a Key
+template <class K, class Key, class = void>
+struct IsLookupKey : std::false_type {};
+
+template <class K, class Key>
+struct IsLookupKey<K, Key, decltype(void(std::declval<const K&>() < std::declval<const Key&>()), void(std::declval<const Key&>() < std::declval<const K&>()))> : std::true_type {};
+
+//---------------------------
+
+enum class TraversalOrder {
+    Preorder = 0,
+    Inorder,
+    Postorder,
+    LevelOrder,
+};
+
+//---------------------------
+
+enum class MapChangeType {
+    Inserted = 0,   // node is a new leaf
+    Removed,        // the node of key is gone, node is null
+    Rotated,        // a rotation made node the root of its subtree
+    Moved,          // node took the place of a removed node, with its subtree
+    Rebuilt         // a bulk operation reshaped the whole tree, node is null
+};
+
+//---------------------------
+
+///One entry of Map's change log. node points into the map and is nulled if the node is removed later on
 template <class Key, class Data>
+struct MapChange {
+    MapChangeType type;
+    const Node<Key, Data>* node;
+    Key key;
+};
+
+//---------------------------
+
+/*
+ * IndexData keeps a count per data value next to the tree, which makes getCountElement() O(1).
+ * It is on by default where the data can be counted (CanIndexData: a std::hash and ==), otherwise
+ * getCountElement() walks the tree. With the index on, get() hands out const data so the counts
+ * cannot go stale behind its back; write through insert_or_assign() then, or turn IndexData off
+ * to get mutable data back.
+ * Stats turns on the operation counters behind stats(), off they compile to nothing.
+ * CacheSlots > 0 puts a two-way set-associative cache of that many recently found nodes in front of get() and find().
+ */
+template <class Key, class Data, class Allocator = NodePool<Node<Key, Data>>, bool IndexData = CanIndexData<Data>::value, bool Stats = false, size_t CacheSlots = 0>
 class Map {
 public:
 
+    typedef typename std::conditional<IndexData, const Data, Data>::type DataRef;
+
+    //---------------------------
+
+    ///In-order bidirectional iterator, walks through parent links without allocating.
+    ///Stays valid until the node it points to is removed
+    class iterator {
+    public:
+
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef Node<Key, Data> value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const Node<Key, Data>* pointer;
+        typedef const Node<Key, Data>& reference;
+
+        iterator() = default;
+
+        reference operator*() const { return *pNode; }
+        pointer operator->() const { return pNode; }
+
+        iterator& operator++() {
+            pNode = Map::successor(pNode);
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator it = *this;
+            ++*this;
+            return it;
+        }
+
+        iterator& operator--() {
+            pNode = pNode ? Map::predecessor(pNode) : Map::rightmost(*pRootLink);
+            return *this;
+        }
+
+        iterator operator--(int) {
+            iterator it = *this;
+            --*this;
+            return it;
+        }
+
+        bool operator==(const iterator& other) const { return pNode == other.pNode; }
+        bool operator!=(const iterator& other) const { return pNode != other.pNode; }
+
+    private:
+
+        friend class Map;
+
+        iterator(Node<Key, Data>* node, Node<Key, Data>* const* rootLink) : pNode(node), pRootLink(rootLink) {}
+
+        Node<Key, Data>* pNode = nullptr;
+        Node<Key, Data>* const* pRootLink = nullptr; // end() has no node, -- starts again from the root
+    };
+
     Map() { pRoot = nullptr; }
     ~Map() { this->clear(); }
 
+    ///Deep copy: same shape, same data index, fresh counters
+    Map(const Map& other) : pRoot(nullptr) { this->copyFrom(other, 0); }
+
+    ///Takes over the nodes of other, which is left empty
+    Map(Map&& other) noexcept : pRoot(nullptr) { this->takeOver(other); }
+
+    //---------------------------
+
+    Map& operator=(const Map& other) {
+
+        if(&other != this) {
+            this->clear();
+            this->copyFrom(other, 0);
+        }
+
+        return *this;
+    }
+
+    //---------------------------
+
+    Map& operator=(Map&& other) noexcept {
+
+        if(&other != this) {
+            this->clear();
+            this->takeOver(other);
+        }
+
+        return *this;
+    }
+
+    //---------------------------
+
+    ///Deep copy built on up to threads workers (0 - one per hardware thread). The top levels fork as in the set
+    ///operations, every task below them counts its subtree and copies it into one block reserved for all its nodes
+    Map clone(unsigned threads = 0) const {
+
+        Map copy;
+        copy.copyFrom(*this, forkDepth(threads));
+
+        return copy;
+    }
+
+    //---------------------------
+
+    ///Same keys with equal data, compared in order in one pass. Shapes may differ, nothing is allocated
+    bool operator==(const Map& other) const {
+
+        if(&other == this)
+            return true;
+
+        Node<Key, Data>* a = leftmost(pRoot);
+        Node<Key, Data>* b = leftmost(other.pRoot);
+
+        for(; a && b; a = successor(a), b = successor(b))
+            if(this->less(a->key, b->key) || this->less(b->key, a->key) || !(a->data == b->data))
+                return false;
+
+        return !a && !b;
+    }
+
+    //---------------------------
+
+    bool operator!=(const Map& other) const {
+        return !(*this == other);
+    }
+
+    //---------------------------
+
+    bool add(const Key& key, const Data& data) {
+        return this->emplaceNode(key, data).second;
+    }
+
+    //---------------------------
+
+    bool add(const std::pair<Key, Data>& pair) {
+        return this->emplaceNode(pair.first, pair.second).second;
+    }
+
+    //---------------------------
+
+    ///Inserts key with data built from args. A key of another type is converted before the lookup, nothing else is built if it exists
+    template <class K, class... Args>
+    std::pair<iterator, bool> emplace(K&& key, Args&&... args) {
+
+        typedef typename std::conditional<std::is_same<typename std::decay<K>::type, Key>::value, K&&, Key>::type Probe;
+
+        return this->toIterator(this->emplaceNode(static_cast<Probe>(std::forward<K>(key)), std::forward<Args>(args)...));
+    }
+
+    //---------------------------
+
+    ///Builds data from args only when key is absent, the arguments are left untouched otherwise
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args) {
+        return this->toIterator(this->emplaceNode(key, std::forward<Args>(args)...));
+    }
+
+    //---------------------------
+
+    template <class... Args>
+    std::pair<iterator, bool> try_emplace(Key&& key, Args&&... args) {
+        return this->toIterator(this->emplaceNode(std::move(key), std::forward<Args>(args)...));
+    }
+
+    //---------------------------
+
+    ///Inserts key or assigns data to the element that has it, second is true on insertion
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(const Key& key, M&& data) {
+        return this->toIterator(this->assignNode(key, std::forward<M>(data)));
+    }
+
+    //---------------------------
+
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(Key&& key, M&& data) {
+        return this->toIterator(this->assignNode(std::move(key), std::forward<M>(data)));
+    }
+
+    //---------------------------
+
+    ///Lookups take any K that compares with Key (a string_view for string keys, say), no Key is built for them
+    template <class K = Key, class = typename std::enable_if<IsLookupKey<K, Key>::value>::type>
+    DataRef* get(const K& key) {
+
+        Node<Key, Data>* node = getNode(key);
+        if(!node)
+            return nullptr;
+
+        return &node->data;
+    }
+
+    //---------------------------
+
+    ///out[i] = get(keys[i]) for the whole batch, returns the number of hits.
+    ///batchWidth lookups advance in turns and prefetch their next node, so their cache misses overlap
+    size_t getBatch(const Key* keys, size_t count, DataRef** out) {
+
+        struct Lookup {
+            Node<Key, Data>* node;
+            size_t index;
+        };
+
+        Lookup lookups[batchWidth];
+        size_t active = 0,
+               next = 0,
+               hits = 0;
+
+        for(; active < batchWidth && next < count; ++active, ++next)
+            lookups[active] = { pRoot, next };
+
+        while(active > 0) {
+
+            for(size_t i = 0; i < active;) {
+
+                Lookup& lookup = lookups[i];
+                Node<Key, Data>* node = lookup.node;
+                const Key& key = keys[lookup.index];
+
+                if(node && this->less(key, node->key))
+                    node = node->left;
+
+                else if(node && this->less(node->key, key))
+                    node = node->right;
+
+                else {
+
+                    // Found or fell off the tree: answer it and give the slot to the next key, or to the last active lookup
+                    out[lookup.index] = node ? &node->data : nullptr;
+                    hits += node != nullptr;
+
+                    if(next < count)
+                        lookup = { pRoot, next++ };
+                    else
+                        lookup = lookups[--active];
+
+                    continue;
+                }
+
+#if defined(__GNUC__)
+                __builtin_prefetch(node);
+#endif
+
+                lookup.node = node;
+                ++i;
+            }
+        }
+
+        return hits;
+    }
+
+    //---------------------------
+
+    size_t getBatch(const std::vector<Key>& keys, std::vector<DataRef*>& out) {
+
+        out.resize(keys.size());
+
+        return this->getBatch(keys.data(), keys.size(), out.data());
+    }
+
+    //---------------------------
+
+    iterator begin() {
+        return iterator(leftmost(pRoot), &pRoot);
+    }
+
+    //---------------------------
+
+    iterator end() {
+        return iterator(nullptr, &pRoot);
+    }
+
+    //---------------------------
+
+    template <class K = Key, class = typename std::enable_if<IsLookupKey<K, Key>::value>::type>
+    iterator find(const K& key) {
+        return iterator(getNode(key), &pRoot);
+    }
+
+    //---------------------------
+
+    ///First element whose key is not less than key
+    template <class K = Key, class = typename std::enable_if<IsLookupKey<K, Key>::value>::type>
+    iterator lower_bound(const K& key) {
+
+        Node<Key, Data>* node = pRoot;
+        Node<Key, Data>* bound = nullptr;
+
+        while(node) {
+
+            if(this->less(node->key, key))
+                node = node->right;
+
+            else {
+                bound = node;
+                node = node->left;
+            }
+        }
+
+        return iterator(bound, &pRoot);
+    }
+
+    //---------------------------
+
+    ///First element whose key is greater than key
+    template <class K = Key, class = typename std::enable_if<IsLookupKey<K, Key>::value>::type>
+    iterator upper_bound(const K& key) {
+
+        Node<Key, Data>* node = pRoot;
+        Node<Key, Data>* bound = nullptr;
+
+        while(node) {
+
+            if(this->less(key, node->key)) {
+                bound = node;
+                node = node->left;
+            }
+
+            else
+                node = node->right;
+        }
+
+        return iterator(bound, &pRoot);
+    }
+
+    //---------------------------
+
+    template <class K = Key, class = typename std::enable_if<IsLookupKey<K, Key>::value>::type>
+    std::pair<iterator, iterator> equal_range(const K& key) {
+        return { this->lower_bound(key), this->upper_bound(key) };
+    }
+
+    //---------------------------
+
+    ///Calls fn(key, data) for every key in [lo, hi) in order, O(log n + k). Returns the number of visited elements
+    template <class Function>
+    size_t forEachInRange(const Key& lo, const Key& hi, Function fn) {
+
+        size_t count = 0;
+
+        for(Node<Key, Data>* node = this->lower_bound(lo).pNode; node && this->less(node->key, hi); node = successor(node)) {
+            fn(static_cast<const Key&>(node->key), static_cast<DataRef&>(node->data));
+            ++count;
+        }
+
+        return count;
+    }
+
+    //---------------------------
+
+    ///Immutable copy for read-mostly lookups, later changes of the map are not reflected in it
+    FrozenMap<Key, Data> freeze() const {
+
+        std::vector<Key> keys;
+        std::vector<Data> data;
+
+        const Node<Key, Data>* stack[maxPathLength];
+        const Node<Key, Data>* node = pRoot;
+        int depth = 0;
+
+        while(node || depth > 0) {
+
+            while(node) {
+                stack[depth++] = node;
+                node = node->left;
+            }
+
+            node = stack[--depth];
+
+            keys.push_back(node->key);
+            data.push_back(node->data);
+
+            node = node->right;
+        }
+
+        return FrozenMap<Key, Data>(keys, data);
+    }
+
+    //---------------------------
+
+    ///Writes the tree as a binary snapshot (see MapFile.hpp), false on an I/O error
+    bool save(const char* path) const {
+
+        typedef MapFileRecord<Key, Data> Record;
+
+        MapFileWriter<Key, Data> writer(path);
+
+        // In postorder the subtrees of a node are written right before it, their record indices wait here
+        uint32_t done[maxPathLength + 1];
+        int depth = 0;
+
+        this->traverse(TraversalOrder::Postorder, [&](const Node<Key, Data>& node) {
+
+            uint32_t right = node.right ? done[--depth] : Record::noLink;
+            uint32_t left = node.left ? done[--depth] : Record::noLink;
+
+            done[depth++] = writer.append(node.key, node.data, node.height, left, right);
+        });
+
+        return writer.finish(depth > 0 ? done[0] : Record::noLink);
+    }
+
     //---------------------------
 
-    bool add(const Key& key, const Data& data) {
-        return this->add({ key, data });
+    ///Replaces the content with a snapshot written by save(), rebuilt in one pass. Every record is checked
+    ///against its subtrees (height, balance, two key comparisons for the order), so a missing, foreign or
+    ///damaged file leaves the map empty, even one with a valid checksum
+    bool load(const char* path) {
+
+        typedef MapFileRecord<Key, Data> Record;
+
+        this->clear();
+
+        MappedMap<Key, Data> file;
+        if(!file.open(path))
+            return this->discard(nullptr, 0);
+
+        const Record* records = file.getRecords();
+
+        Node<Key, Data>* done[maxPathLength + 1];
+        const Node<Key, Data>* lowest[maxPathLength + 1];   // smallest and largest key of done[i]
+        const Node<Key, Data>* highest[maxPathLength + 1];
+        int depth = 0;
+
+        for(size_t i = 0; i < file.getSize(); ++i) {
+
+            const Record& record = records[i];
+
+            bool hasLeft = record.left != Record::noLink,
+                 hasRight = record.right != Record::noLink;
+
+            if(hasLeft + hasRight > depth || depth - hasLeft - hasRight >= maxPathLength)
+                return this->discard(done, depth);
+
+            Node<Key, Data>* node = createNode();
+
+            node->key = record.key;
+            node->data = record.data;
+
+            const Node<Key, Data>* rightLowest = node;
+            const Node<Key, Data>* rightHighest = node;
+            const Node<Key, Data>* leftLowest = node;
+            const Node<Key, Data>* leftHighest = node;
+
+            node->right = nullptr;
+            node->left = nullptr;
+
+            if(hasRight) {
+                --depth;
+                node->right = done[depth];
+                rightLowest = lowest[depth];
+                rightHighest = highest[depth];
+            }
+
+            if(hasLeft) {
+                --depth;
+                node->left = done[depth];
+                leftLowest = lowest[depth];
+                leftHighest = highest[depth];
+            }
+
+            if(node->left)
+                node->left->parent = node;
+
+            if(node->right)
+                node->right->parent = node;
+
+            this->fixHeight(node);
+            pIndex.insert(node->data);
+
+            done[depth] = node;
+            lowest[depth] = leftLowest;
+            highest[depth] = rightHighest;
+            ++depth;
+
+            // An unbalanced or unordered tree would break the fixed-size paths of add() and remove()
+            if(node->height != record.height || this->balanceFactor(node) < -1 || this->balanceFactor(node) > 1 ||
+               (hasLeft && !this->less(leftHighest->key, node->key)) || (hasRight && !this->less(node->key, rightLowest->key)))
+                return this->discard(done, depth);
+        }
+
+        if(depth > 1)
+            return this->discard(done, depth);
+
+        pRoot = depth > 0 ? done[0] : nullptr;
+        this->logRebuild();
+
+        return true;
+    }
+
+    //---------------------------
+
+    bool remove(const Key& key) {
+        return removeNode(key);
+    }
+
+    //---------------------------
+
+    ///Replaces the content with the range [first, last) of pairs sorted by key in O(n)
+    template <class Iterator>
+    void assignSorted(Iterator first, Iterator last) {
+
+        this->clear();
+        this->mergeSorted(first, last);
+    }
+
+    //---------------------------
+
+    ///Merges the range [first, last) of pairs sorted by key in O(n + m), returns the number of added pairs.
+    ///As with add(), keys that are already present (or repeated in the range) keep their first value
+    template <class Iterator>
+    size_t mergeSorted(Iterator first, Iterator last) {
+
+        Node<Key, Data> head;
+        Node<Key, Data>* tail = &head;
+        Node<Key, Data>* list = treeToList(pRoot);
+
+        size_t count = 0,
+               added = 0;
+
+        while(first != last || list) {
+
+            Node<Key, Data>* node;
+
+            if(first == last || (list && this->less(list->key, first->first))) {
+
+                node = list;
+                list = list->right;
+
+            } else {
+
+                if((list && !this->less(first->first, list->key)) || (tail != &head && !this->less(tail->key, first->first))) {
+                    ++first;
+                    continue;
+                }
+
+                node = createNode();
+                node->key = first->first;
+                node->data = first->second;
+
+                pIndex.insert(node->data);
+
+                ++first;
+                ++added;
+            }
+
+            tail->right = node;
+            tail = node;
+            ++count;
+        }
+
+        tail->right = nullptr;
+        list = head.right;
+
+        pRoot = listToTree(count, list);
+
+        if(pRoot)
+            pRoot->parent = nullptr;
+
+        this->logRebuild();
+
+        return added;
+    }
+
+    //---------------------------
+
+    ///Moves every element whose key is not less than key into greater, dropping what greater held.
+    ///O(log n), the nodes change owner without being copied (with IndexData the counts of the smaller part move one by one)
+    void split(const Key& key, Map& greater) {
+
+        if(&greater == this)
+            return;
+
+        greater.clear();
+        this->forgetNodes(); // half of the nodes are about to belong to greater
+
+        Node<Key, Data>* left;
+        Node<Key, Data>* found;
+        Node<Key, Data>* right;
+
+        this->splitTree(pRoot, key, left, found, right);
+
+        if(found)
+            right = this->joinTree(nullptr, found, right);
+
+        if(IndexData) {
+
+            if(height(right) <= height(left))
+                moveCounts(right, pIndex, greater.pIndex);
+
+            else {
+                std::swap(pIndex, greater.pIndex);
+                moveCounts(left, greater.pIndex, pIndex);
+            }
+        }
+
+        pRoot = left;
+        greater.pRoot = right;
+        greater.pAlloc.adopt(pAlloc);
+        greater.logRebuild(); // clear() logs nothing for a greater that was already empty
+    }
+
+    //---------------------------
+
+    ///Appends greater and leaves it empty in O(log n). Every key of greater must be larger than the keys of this map,
+    ///overlapping maps are merged as by unionWith()
+    void join(Map& greater) {
+
+        if(&greater == this || !greater.pRoot)
+            return;
+
+        if(pRoot && !this->less(rightmost(pRoot)->key, leftmost(greater.pRoot)->key)) {
+            this->unionWith(greater);
+            greater.clear();
+            return;
+        }
+
+        this->absorb(greater, nullptr);
+    }
+
+    //---------------------------
+
+    ///join() with key between the two maps, key must be larger than the keys of this map and less than those of greater
+    void join(const Key& key, const Data& data, Map& greater) {
+
+        Node<Key, Data>* max = rightmost(pRoot);
+        Node<Key, Data>* min = &greater == this ? nullptr : leftmost(greater.pRoot);
+
+        if((max && !this->less(max->key, key)) || (min && !this->less(key, min->key))) {
+            this->add(key, data);
+            this->join(greater);
+            return;
+        }
+
+        Node<Key, Data>* node = createNode();
+
+        node->key = key;
+        node->data = data;
+
+        this->absorb(greater, node);
+    }
+
+    //---------------------------
+
+    ///Adds the elements of other whose keys are missing here (common keys keep the data of this map),
+    ///returns the number of added elements. Join-based, O(m log(n/m + 1)) work for sizes n and m,
+    ///forked over up to threads workers (0 - one per hardware thread)
+    size_t unionWith(const Map& other, unsigned threads = 0) {
+
+        if(&other == this)
+            return 0;
+
+        SetContext context;
+        pRoot = this->unionTree(pRoot, other.pRoot, context, forkDepth(threads));
+
+        return this->finish(context);
+    }
+
+    //---------------------------
+
+    ///Keeps only the keys that are also in other, returns the number of removed elements
+    size_t intersect(const Map& other, unsigned threads = 0) {
+
+        if(&other == this)
+            return 0;
+
+        SetContext context;
+        pRoot = this->intersectTree(pRoot, other.pRoot, context, forkDepth(threads));
+
+        return this->finish(context);
+    }
+
+    //---------------------------
+
+    ///Removes the keys that are in other, returns the number of removed elements
+    size_t difference(const Map& other, unsigned threads = 0) {
+
+        SetContext context;
+
+        if(&other == this) {
+            collect(pRoot, context);
+            pRoot = nullptr;
+        } else
+            pRoot = this->differenceTree(pRoot, other.pRoot, context, forkDepth(threads));
+
+        return this->finish(context);
+    }
+
+    //---------------------------
+
+    void clear() {
+
+        if(!pRoot)
+            return;
+
+        // The pool drops whole slabs, so only walk the tree when something has to be destroyed or freed one by one
+        if(!Allocator::bulkRelease || !std::is_trivially_destructible<Node<Key, Data>>::value)
+            removeAll(pRoot);
+
+        pAlloc.release();
+        pIndex.clear();
+        this->forgetNodes();
+        pRoot = nullptr;
+    }
+
+    //---------------------------
+
+    std::string inorder() {
+
+        std::string data;
+        this->write(TraversalOrder::Inorder, data);
+
+        data += " end";
+
+        return data;
+    }
+
+    //---------------------------
+
+    std::string preorder() {
+
+        std::string data;
+        this->write(TraversalOrder::Preorder, data);
+
+        data += " end";
+
+        return data;
+    }
+
+    //---------------------------
+
+    std::string postorder() {
+
+        std::string data;
+        this->write(TraversalOrder::Postorder, data);
+
+        data += " end";
+
+        return data;
+    }
+
+    //---------------------------
+
+    ///Calls visit(const Node<Key, Data>&) for every node in the given order.
+    ///The depth-first orders walk through parent links, so nothing is allocated and the stack depth is constant.
+    ///Level order is the one pass of levelOrder()
+    template <class Visitor>
+    void traverse(TraversalOrder order, Visitor visit) const {
+
+        if(order == TraversalOrder::LevelOrder)
+            this->levelOrder([&visit](const Node<Key, Data>& node, int) { visit(node); });
+        else
+            this->walk(order, visit);
+    }
+
+    //---------------------------
+
+    ///Streams "{key:data} --> " records in the given order into sink
+    void write(TraversalOrder order, TextSink& sink) const {
+
+        this->traverse(order, [&sink](const Node<Key, Data>& node) {
+            sink.put('{');
+            sink.text(node.key);
+            sink.put(':');
+            sink.text(node.data);
+            sink.write("} --> ", 6);
+        });
+    }
+
+    //---------------------------
+
+    void write(TraversalOrder order, FILE* file) const {
+
+        TextSink sink(file);
+        this->write(order, sink);
+    }
+
+    //---------------------------
+
+    void write(TraversalOrder order, std::string& out) const {
+
+        TextSink sink(out);
+        this->write(order, sink);
+    }
+
+    //---------------------------
+
+    ///Calls visit(const Node<Key, Data>&, int level) in level order in one pass (see TreeOrder.hpp).
+    ///The buffers of the pass belong to the call, the overloads below take them from the caller to be reused
+    template <class Visitor>
+    void levelOrder(Visitor visit) const {
+
+        TreeOrder<Node<Key, Data>> order;
+        order.levelOrder(pRoot, visit);
+    }
+
+    //---------------------------
+
+    template <class Visitor>
+    void levelOrder(TreeOrder<Node<Key, Data>>& order, Visitor visit) const {
+        order.levelOrder(pRoot, visit);
+    }
+
+    //---------------------------
+
+    ///Calls visit(const Node<Key, Data>&, int column) column by column, the root is column 0
+    template <class Visitor>
+    void verticalOrder(Visitor visit) const {
+
+        TreeOrder<Node<Key, Data>> order;
+        order.verticalOrder(pRoot, visit);
+    }
+
+    //---------------------------
+
+    template <class Visitor>
+    void verticalOrder(TreeOrder<Node<Key, Data>>& order, Visitor visit) const {
+        order.verticalOrder(pRoot, visit);
+    }
+
+    //---------------------------
+
+    ///Streams the keys in level order, "key " each
+    void writeHorizontal(TextSink& sink) const {
+
+        TreeOrder<Node<Key, Data>> order;
+        this->writeHorizontal(sink, order);
+    }
+
+    //---------------------------
+
+    void writeHorizontal(TextSink& sink, TreeOrder<Node<Key, Data>>& order) const {
+
+        this->levelOrder(order, [&sink](const Node<Key, Data>& node, int) {
+            sink.text(node.key);
+            sink.put(' ');
+        });
+    }
+
+    //---------------------------
+
+    ///Streams one line of "key " per column, leftmost column first
+    void writeVertical(TextSink& sink) const {
+
+        TreeOrder<Node<Key, Data>> order;
+        this->writeVertical(sink, order);
+    }
+
+    //---------------------------
+
+    void writeVertical(TextSink& sink, TreeOrder<Node<Key, Data>>& order) const {
+
+        bool first = true;
+        int line = 0;
+
+        this->verticalOrder(order, [&](const Node<Key, Data>& node, int column) {
+
+            if(!first && column != line)
+                sink.put('\n');
+
+            first = false;
+            line = column;
+
+            sink.text(node.key);
+            sink.put(' ');
+        });
+
+        if(!first)
+            sink.put('\n');
+    }
+
+    //---------------------------
+
+    std::string getPrintHorizontal() const {
+
+        std::string data;
+        {
+            TextSink sink(data);
+            this->writeHorizontal(sink);
+        }
+
+        return data;
+    }
+
+    //---------------------------
+
+    std::string getPrintVertical() const {
+
+        std::string data;
+        {
+            TextSink sink(data);
+            this->writeVertical(sink);
+        }
+
+        return data;
+    }
+
+    //---------------------------
+
+    std::vector<DataS<Key, Data>> getTree() const {
+
+        std::vector<DataS<Key, Data>> buff;
+
+        if (pRoot != nullptr) {
+            DataS<Key, Data> data;
+
+            data.node = pRoot;
+            data.level = 0;
+            data.state = 0;
+
+            buff.push_back(data);
+            tree(pRoot, 1, buff);
+        }
+
+        return buff;
+    }
+
+    //---------------------------
+
+    ///Writes every node into layout in preorder, one iterative pass. The arrays of layout are reused,
+    ///so exporting a tree no larger than the last one does not allocate
+    void exportLayout(TreeLayout<Key, Data>& layout) const {
+
+        struct Place {
+            const Node<Key, Data>* node;
+            int level;
+            uint64_t offset;
+        };
+
+        Place stack[maxPathLength + 1];
+        int depth = 0;
+
+        layout.clear();
+
+        if(pRoot)
+            stack[depth++] = { pRoot, 0, 0 };
+
+        while(depth > 0) {
+
+            Place place = stack[--depth];
+            const Node<Key, Data>* node = place.node;
+
+            layout.push(node->key, node->data, place.level, place.offset);
+
+            // Right below left, so the left subtree comes out first
+            if(node->right)
+                stack[depth++] = { node->right, place.level + 1, place.offset * 2 + 1 };
+
+            if(node->left)
+                stack[depth++] = { node->left, place.level + 1, place.offset * 2 };
+        }
+    }
+
+    //---------------------------
+
+    size_t getCountElement(Data data) const {
+
+        if(IndexData)
+            return pIndex.count(data);
+
+        size_t counter = 0;
+        this->preorderFind(pRoot, data, counter);
+
+        return counter;
+    }
+
+    //---------------------------
+
+    void debugPrint() const {
+        std::cout << "tree print:\n";
+
+        if (pRoot != nullptr) {
+
+            std::cout << "[+]={" + std::to_string(pRoot->key) + ":" + pRoot->data + "}\n";
+            debug(pRoot, 2);
+        }
+    }
+
+    //---------------------------
+
+    ///Comparisons, rotations, height fixes, node allocations and path depths since the last resetStats(), all zero without Stats
+    MapCounters stats() const {
+        return pStats.get();
+    }
+
+    //---------------------------
+
+    void resetStats() {
+        pStats.reset();
+    }
+
+    //---------------------------
+
+    ///Lookups answered by the hot-key cache and lookups that had to walk the tree, all zero without CacheSlots
+    HotCacheCounters cacheStats() const {
+        return pCache.get();
+    }
+
+    //---------------------------
+
+    void resetCacheStats() {
+        pCache.reset();
+    }
+
+    //---------------------------
+
+    ///With finger search on, get(), find(), add() and remove() start from the last node they touched instead of the root.
+    ///They climb from it to the lowest ancestor whose subtree spans the key, about log d levels for keys d apart
+    void setFingerSearch(bool enabled) {
+        pFingerSearch = enabled;
+        pFinger = nullptr;
+    }
+
+    //---------------------------
+
+    bool isFingerSearch() const {
+        return pFingerSearch;
+    }
+
+    //---------------------------
+
+    ///With the change log on, add() and remove() record the shape changes they make, so a view of the tree
+    ///can patch the subtrees that moved instead of rebuilding (TreeRenderer::applyChanges). Bulk operations
+    ///(clear, split, join, the set operations, assignSorted, mergeSorted, load, assignment) record a single Rebuilt,
+    ///also when they fail or start from an empty map
+    void setChangeLog(bool enabled) {
+        pLogChanges = enabled;
+        pChanges.clear();
+
+        // Room for the Rebuilt entry of clear(), which the moves go through and must not allocate in
+        if(enabled)
+            pChanges.reserve(1);
+    }
+
+    //---------------------------
+
+    ///Changes since the last clearChanges(), oldest first
+    const std::vector<MapChange<Key, Data>>& getChanges() const {
+        return pChanges;
+    }
+
+    //---------------------------
+
+    void clearChanges() {
+        pChanges.clear();
+    }
+
+    //---------------------------
+
+private:
+
+    // AVL height is below 1.45 * log2(n + 2), 64 levels is more than any addressable tree needs
+    static constexpr int maxPathLength = 64;
+
+    // Lookups getBatch() keeps in flight, enough to cover a memory miss with the steps of the others
+    static constexpr size_t batchWidth = 16;
+
+    Node<Key, Data>* pRoot;
+
+    Allocator pAlloc;
+    DataIndex<Data, IndexData> pIndex;
+    mutable MapStats<Stats> pStats;
+    HotCache<Node<Key, Data>, CacheSlots> pCache;
+
+    Node<Key, Data>* pFinger = nullptr; // last node touched with finger search on
+    bool pFingerSearch = false;
+
+    std::vector<MapChange<Key, Data>> pChanges;
+    bool pLogChanges = false;
+
+    //---------------------------
+
+    template <class... Args>
+    Node<Key, Data>* createNode(Args&&... args) {
+
+        Node<Key, Data>* slot = pAlloc.allocate();
+        pStats.allocate();
+
+        try {
+            return new (slot) Node<Key, Data>(std::forward<Args>(args)...);
+        }
+        catch(...) {
+            pAlloc.deallocate(slot);
+            throw;
+        }
+    }
+
+    //---------------------------
+
+    void destroyNode(Node<Key, Data>* node) {
+
+        node->~Node<Key, Data>();
+
+        if(!Allocator::bulkRelease) {
+            pAlloc.deallocate(node);
+            pStats.free();
+        }
+    }
+
+    //---------------------------
+
+    void freeNode(Node<Key, Data>* node) {
+
+        pCache.erase(node);
+
+        if(node == pFinger)
+            pFinger = nullptr;
+
+        if(pLogChanges)
+            for(size_t i = 0; i < pChanges.size(); ++i)
+                if(pChanges[i].node == node)
+                    pChanges[i].node = nullptr;
+
+        node->~Node<Key, Data>();
+        pAlloc.deallocate(node);
+        pStats.free();
+    }
+
+    //---------------------------
+
+    void debug(Node<Key, Data>* node, int indent) const {
+
+        if (node != nullptr) {
+
+            std::string str(indent, ' ');
+
+            if (node->left != nullptr)
+                std::cout << str + "[L]={" + std::to_string(node->left->key) + ":" + node->left->data + "}\n";
+
+            debug(node->left, indent + 2);
+
+            if (node->right != nullptr)
+                std::cout << str + "[R]={" + std::to_string(node->right->key) + ":" + node->right->data + "}\n";
+
+            debug(node->right, indent + 2);
+        }
+    }
+
+    //---------------------------
+
+    void preorderFind(Node<Key, Data>* node, const Data& data, size_t& count) const {
+
+        if(!node) return;
+
+        if(node->data == data)
+            ++count;
+
+        preorderFind(node->left, data, count);
+        preorderFind(node->right, data, count);
+    }
+
+    //---------------------------
+
+    void tree(Node<Key, Data>* node, int level, std::vector<DataS<Key, Data>> &data) const {
+
+        if (node != nullptr) {
+
+            if (node->left != nullptr) {
+
+                DataS<Key, Data> buff;
+                buff.level = level;
+                buff.state = 1;
+                buff.node = node->left;
+
+                data.push_back(buff);
+            }
+
+            tree(node->left, level + 1, data);
+
+            if (node->right != nullptr) {
+
+                DataS<Key, Data> buff;
+                buff.level = level;
+                buff.state = 2;
+                buff.node = node->right;
+
+                data.push_back(buff);
+            }
+
+            tree(node->right, level + 1, data);
+        }
+    }
+
+    //---------------------------
+
+    // Depth-first walk over parent links: a node is entered from its parent, then returned to from the left
+    // and from the right child
+    template <class Visitor>
+    void walk(TraversalOrder order, Visitor& visit) const {
+
+        const Node<Key, Data>* node = pRoot;
+        const Node<Key, Data>* from = nullptr;
+
+        while(node) {
+
+            const Node<Key, Data>* left = node->left;
+            const Node<Key, Data>* right = node->right;
+
+            if(from == node->parent) {
+
+                if(order == TraversalOrder::Preorder)
+                    visit(*node);
+
+                if(left) {
+                    from = node;
+                    node = left;
+                    continue;
+                }
+
+                from = left;
+            }
+
+            if(from == left) {
+
+                if(order == TraversalOrder::Inorder)
+                    visit(*node);
+
+                if(right) {
+                    from = node;
+                    node = right;
+                    continue;
+                }
+            }
+
+            if(order == TraversalOrder::Postorder)
+                visit(*node);
+
+            from = node;
+            node = node->parent;
+        }
+    }
+
+    // Drops the subtrees built by a load() that failed
+    bool discard(Node<Key, Data>** subtrees, int count) {
+
+        if(!Allocator::bulkRelease || !std::is_trivially_destructible<Node<Key, Data>>::value)
+            while(count > 0)
+                removeAll(subtrees[--count]);
+
+        pAlloc.release();
+        pIndex.clear();
+        this->logRebuild();
+
+        return false;
+    }
+
+    //---------------------------
+
+    void removeAll(Node<Key, Data>* node) {
+        if(node != nullptr) {
+            removeAll(node->left);
+            removeAll(node->right);
+
+            destroyNode(node);
+            node = nullptr;
+        }
+    }
+
+    // Walks down to key and builds the node out of key and args only if it is not there, second is false for an existing key
+    template <class K, class... Args>
+    std::pair<Node<Key, Data>*, bool> emplaceNode(K&& key, Args&&... args) {
+
+        Node<Key, Data>* start = this->searchStart(key);
+        Node<Key, Data>* above = start ? start->parent : nullptr;
+
+        Node<Key, Data>** path[maxPathLength];
+        Node<Key, Data>** link = start ? this->linkTo(start) : &pRoot;
+        Node<Key, Data>* parent = above;
+        int depth = 0;
+
+        while(*link) {
+
+            Node<Key, Data>* node = *link;
+            path[depth++] = link;
+            parent = node;
+
+            if(this->less(key, node->key))
+                link = &node->left;
+
+            else if(this->less(node->key, key))
+                link = &node->right;
+
+            else {
+                pStats.walk(depth);
+                this->touch(node);
+                return { node, false };
+            }
+        }
+
+        pStats.walk(depth);
+
+        Node<Key, Data>* node = createNode(std::piecewise_construct, std::forward<K>(key), std::forward<Args>(args)...);
+
+        node->parent = parent;
+
+        pIndex.insert(node->data);
+
+        *link = node;
+
+        this->logChange(MapChangeType::Inserted, node);
+
+        retrace(path, depth, above);
+        this->touch(node);
+
+        return { node, true };
+    }
+
+    //---------------------------
+
+    template <class K, class M>
+    std::pair<Node<Key, Data>*, bool> assignNode(K&& key, M&& data) {
+
+        std::pair<Node<Key, Data>*, bool> result = this->emplaceNode(std::forward<K>(key), std::forward<M>(data));
+
+        if(!result.second) {
+            pIndex.erase(result.first->data);
+            result.first->data = std::forward<M>(data);
+            pIndex.insert(result.first->data);
+        }
+
+        return result;
+    }
+
+    //---------------------------
+
+    std::pair<iterator, bool> toIterator(std::pair<Node<Key, Data>*, bool> result) {
+        return { iterator(result.first, &pRoot), result.second };
+    }
+
+    //---------------------------
+
+    // Flattens the tree into an in-order list linked through right, rotating left children away
+    Node<Key, Data>* treeToList(Node<Key, Data>* root) {
+
+        Node<Key, Data> head;
+        Node<Key, Data>* tail = &head;
+
+        head.right = root;
+
+        while(Node<Key, Data>* rest = tail->right) {
+
+            if(!rest->left) {
+                tail = rest;
+                continue;
+            }
+
+            Node<Key, Data>* left = rest->left;
+
+            rest->left = left->right;
+            left->right = rest;
+            tail->right = left;
+        }
+
+        return head.right;
+    }
+
+    //---------------------------
+
+    // Builds a perfectly balanced tree out of the first count list nodes and advances list past them
+    Node<Key, Data>* listToTree(size_t count, Node<Key, Data>*& list) {
+
+        if(count == 0)
+            return nullptr;
+
+        size_t leftCount = (count - 1) / 2;
+
+        Node<Key, Data>* left = listToTree(leftCount, list);
+        Node<Key, Data>* node = list;
+
+        list = list->right;
+
+        node->left = left;
+        node->right = listToTree(count - 1 - leftCount, list);
+
+        if(node->left)
+            node->left->parent = node;
+
+        if(node->right)
+            node->right->parent = node;
+
+        this->fixHeight(node);
+
+        return node;
+    }
+
+    //---------------------------
+
+    // Subtrees below this height are not worth a thread of their own
+    static constexpr int parallelHeight = 12;
+
+    // What the set operations allocate and unlink while they run, applied to the map once all workers are done
+    struct SetContext {
+
+        Allocator alloc;
+        std::vector<Node<Key, Data>*> added,   // only kept for the data index
+                                      removed;
+        size_t addedCount = 0;
+
+        void absorb(SetContext& other) {
+
+            alloc.adopt(other.alloc);
+
+            added.insert(added.end(), other.added.begin(), other.added.end());
+            removed.insert(removed.end(), other.removed.begin(), other.removed.end());
+            addedCount += other.addedCount;
+        }
+    };
+
+    //---------------------------
+
+    static int forkDepth(unsigned threads) {
+
+        if(threads == 0)
+            threads = std::thread::hardware_concurrency();
+
+        int depth = 0;
+        while((1u << depth) < threads && depth < 16)
+            ++depth;
+
+        return depth;
+    }
+
+    //---------------------------
+
+    // Runs left and right, the left one on a new thread while forks are left and the subproblem is large enough
+    template <class Left, class Right>
+    static void forkJoin(SetContext& context, int forks, int size, Left left, Right right) {
+
+        if(forks <= 0 || size < parallelHeight) {
+            left(context, 0);
+            right(context, 0);
+            return;
+        }
+
+        SetContext side;
+        std::thread worker([&]() { left(side, forks - 1); });
+
+        right(context, forks - 1);
+        worker.join();
+
+        context.absorb(side);
+    }
+
+    //---------------------------
+
+    size_t finish(SetContext& context) {
+
+        if(pRoot)
+            pRoot->parent = nullptr;
+
+        pAlloc.adopt(context.alloc);
+        pStats.allocate(context.addedCount);
+
+        this->logRebuild();
+
+        for(size_t i = 0; i < context.added.size(); ++i)
+            pIndex.insert(context.added[i]->data);
+
+        for(size_t i = 0; i < context.removed.size(); ++i) {
+            pIndex.erase(context.removed[i]->data);
+            freeNode(context.removed[i]);
+        }
+
+        return context.addedCount + context.removed.size();
+    }
+
+    //---------------------------
+
+    // Fills this empty map with copies of the nodes of other
+    void copyFrom(const Map& other, int forks) {
+
+        SetContext context;
+        pRoot = cloneTree(other.pRoot, context, forks);
+
+        if(pRoot)
+            pRoot->parent = nullptr;
+
+        pAlloc.adopt(context.alloc);
+        pStats.allocate(context.addedCount);
+        pIndex = other.pIndex;
+        pFingerSearch = other.pFingerSearch;
+
+        this->logRebuild();
+    }
+
+    //---------------------------
+
+    // Moves the tree of other into this empty map, the pools trade places so nothing is allocated
+    void takeOver(Map& other) noexcept {
+
+        pRoot = other.pRoot;
+        other.pRoot = nullptr;
+
+        pAlloc.swap(other.pAlloc);
+        other.pAlloc.release();
+
+        std::swap(pIndex, other.pIndex);
+        other.pIndex.clear();
+        other.forgetNodes();
+
+        pFingerSearch = other.pFingerSearch;
+
+        this->logRebuild(); // empties the log first, so it reuses the entry setChangeLog() reserved
+    }
+
+    //---------------------------
+
+    // Links greater (and node between the two, if any) onto this tree and takes over its memory and counts
+    void absorb(Map& greater, Node<Key, Data>* node) {
+
+        Node<Key, Data>* left = pRoot;
+        Node<Key, Data>* right = &greater == this ? nullptr : greater.pRoot;
+
+        if(IndexData && right) {
+
+            if(height(right) <= height(left))
+                moveCounts(right, greater.pIndex, pIndex);
+
+            else {
+                std::swap(pIndex, greater.pIndex);
+                moveCounts(left, greater.pIndex, pIndex);
+            }
+        }
+
+        if(node) {
+            pIndex.insert(node->data);
+            pRoot = this->joinTree(left, node, right);
+        } else
+            pRoot = this->concatTree(left, right);
+
+        this->logRebuild();
+
+        if(right) {
+            pAlloc.adopt(greater.pAlloc);
+
+            greater.pRoot = nullptr;
+            greater.pIndex.clear();
+            greater.forgetNodes();
+            greater.pAlloc.release();
+        }
+    }
+
+    //---------------------------
+
+    static void moveCounts(const Node<Key, Data>* root, DataIndex<Data, IndexData>& from, DataIndex<Data, IndexData>& to) {
+
+        const Node<Key, Data>* stack[maxPathLength];
+        int depth = 0;
+
+        if(root)
+            stack[depth++] = root;
+
+        while(depth > 0) {
+
+            const Node<Key, Data>* node = stack[--depth];
+
+            from.erase(node->data);
+            to.insert(node->data);
+
+            if(node->left) stack[depth++] = node->left;
+            if(node->right) stack[depth++] = node->right;
+        }
+    }
+
+    //---------------------------
+
+    // Hands every node under root over to the context for removal
+    static void collect(Node<Key, Data>* root, SetContext& context) {
+
+        Node<Key, Data>* stack[maxPathLength];
+        int depth = 0;
+
+        if(root)
+            stack[depth++] = root;
+
+        while(depth > 0) {
+
+            Node<Key, Data>* node = stack[--depth];
+            context.removed.push_back(node);
+
+            if(node->left) stack[depth++] = node->left;
+            if(node->right) stack[depth++] = node->right;
+        }
     }
 
     //---------------------------
 
-    bool add(const std::pair<Key, Data>& pair) {
+    static Node<Key, Data>* copyNode(const Node<Key, Data>* node, SetContext& context) {
+
+        Node<Key, Data>* copy = new (context.alloc.allocate()) Node<Key, Data>();
 
-        bool contains = false;
-        pRoot = addNode(pair, pRoot, contains);
+        copy->key = node->key;
+        copy->data = node->data;
+        copy->height = 1;
 
-        return !contains;
+        ++context.addedCount;
+
+        if(IndexData)
+            context.added.push_back(copy);
+
+        return copy;
     }
 
     //---------------------------
 
-    Data* get(const Key& key) {
+    // Same shape and heights, so the copy is balanced as it is
+    static Node<Key, Data>* copyTree(const Node<Key, Data>* node, SetContext& context) {
 
-        Node<Key, Data>* node = getNode(key);
         if(!node)
             return nullptr;
 
-        return &node->data;
-    }
+        Node<Key, Data>* copy = copyNode(node, context);
 
-    //---------------------------
+        copy->left = copyTree(node->left, context);
+        copy->right = copyTree(node->right, context);
+        copy->height = node->height;
 
-    bool remove(const Key& key) {
+        if(copy->left)
+            copy->left->parent = copy;
 
-        bool contains = false;
-        pRoot = remove(pRoot, key, contains);
+        if(copy->right)
+            copy->right->parent = copy;
 
-        return contains;
+        return copy;
     }
 
     //---------------------------
 
-    void clear() {
+    // Forks over both children while forks are left, below that the whole subtree is counted and copied into one block
+    static Node<Key, Data>* cloneTree(const Node<Key, Data>* node, SetContext& context, int forks) {
 
-        if(!pRoot)
-            return;
+        if(!node)
+            return nullptr;
 
-        removeAll(pRoot);
-        pRoot = nullptr;
+        if(forks <= 0 || node->height < parallelHeight) {
+            context.alloc.reserve(countNodes(node));
+            return cloneNodes(node, context);
+        }
+
+        Node<Key, Data>* copy = cloneNode(node, context);
+
+        forkJoin(context, forks, node->height,
+            [&](SetContext& side, int rest) { copy->left = cloneTree(node->left, side, rest); },
+            [&](SetContext& side, int rest) { copy->right = cloneTree(node->right, side, rest); });
+
+        copy->left->parent = copy;
+        copy->right->parent = copy;
+
+        return copy;
     }
 
     //---------------------------
 
-    std::string inorder() {
+    // Preorder, so a reserved block holds the subtree root first and each child subtree in one run
+    static Node<Key, Data>* cloneNodes(const Node<Key, Data>* node, SetContext& context) {
 
-        std::string data;
-        inorder(pRoot, data);
+        if(!node)
+            return nullptr;
 
-        data += " end";
+        Node<Key, Data>* copy = cloneNode(node, context);
 
-        return data;
+        copy->left = cloneNodes(node->left, context);
+        copy->right = cloneNodes(node->right, context);
+
+        if(copy->left)
+            copy->left->parent = copy;
+
+        if(copy->right)
+            copy->right->parent = copy;
+
+        return copy;
     }
 
     //---------------------------
 
-    std::string preorder() {
+    // Unlike copyNode() this one is not reported to the data index, the clone takes the whole index over
+    static Node<Key, Data>* cloneNode(const Node<Key, Data>* node, SetContext& context) {
 
-        std::string data;
-        preorder(pRoot, data);
+        Node<Key, Data>* copy = new (context.alloc.allocate()) Node<Key, Data>(std::piecewise_construct, node->key, node->data);
 
-        data += " end";
+        copy->height = node->height;
+        ++context.addedCount;
 
-        return data;
+        return copy;
     }
 
     //---------------------------
 
-    std::string postorder() {
+    static size_t countNodes(const Node<Key, Data>* root) {
 
-        std::string data;
-        postorder(pRoot, data);
+        const Node<Key, Data>* stack[maxPathLength];
+        int depth = 0;
+        size_t count = 0;
 
-        data += " end";
+        if(root)
+            stack[depth++] = root;
 
-        return data;
+        while(depth > 0) {
+
+            const Node<Key, Data>* node = stack[--depth];
+            ++count;
+
+            if(node->left) stack[depth++] = node->left;
+            if(node->right) stack[depth++] = node->right;
+        }
+
+        return count;
     }
 
     //---------------------------
 
-    std::string getPrintHorizontal() {
+    // Makes node the root over left and right, which have to fit its balance already
+    Node<Key, Data>* link(Node<Key, Data>* left, Node<Key, Data>* node, Node<Key, Data>* right) {
 
-        if(!pRoot)
-            return "";
+        node->left = left;
+        node->right = right;
+        node->parent = nullptr;
 
-        std::string data;
-        printHorizontal(pRoot, data);
+        if(left)
+            left->parent = node;
 
-        return data;
+        if(right)
+            right->parent = node;
+
+        this->fixHeight(node);
+
+        return node;
     }
 
     //---------------------------
 
-    std::string getPrintVertical() {
+    // One tree out of left < node < right, O(|height(left) - height(right)|)
+    Node<Key, Data>* joinTree(Node<Key, Data>* left, Node<Key, Data>* node, Node<Key, Data>* right) {
 
-        if(!pRoot)
-            return "";
+        if(left)
+            left->parent = nullptr;
 
-        std::string data;
-        printVertical(pRoot, data);
+        if(right)
+            right->parent = nullptr;
 
-        return data;
+        if(height(left) > height(right) + 1)
+            return this->joinRight(left, node, right);
+
+        if(height(right) > height(left) + 1)
+            return this->joinLeft(left, node, right);
+
+        return this->link(left, node, right);
     }
 
     //---------------------------
 
-    std::vector<DataS<Key, Data>> getTree() {
+    // left is the taller one: node and right go down its right spine to the first subtree of about their height
+    Node<Key, Data>* joinRight(Node<Key, Data>* left, Node<Key, Data>* node, Node<Key, Data>* right) {
 
-        std::vector<DataS<Key, Data>> buff;
+        Node<Key, Data>* spine = left->right;
 
-        pDCount = 0;
+        if(height(spine) <= height(right) + 1) {
 
-        if (pRoot != nullptr) {
-            DataS<Key, Data> data;
+            Node<Key, Data>* joined = this->link(spine, node, right);
 
-            data.node = pRoot;
-            data.level = pDCount;
-            data.state = 0;
+            if(height(joined) <= height(left->left) + 1)
+                return this->link(left->left, left, joined);
 
-            buff.push_back(data);
-            tree(pRoot, buff);
+            pStats.rotateTwice();
+            this->link(left->left, left, rotateRight(joined));
+            return rotateLeft(left);
         }
 
-        return buff;
-    }
-
-    //---------------------------
-
-    size_t getCountElement(Data data) {
+        Node<Key, Data>* joined = this->joinRight(spine, node, right);
+        this->link(left->left, left, joined);
 
-        size_t counter = 0;
-        this->preorderFind(pRoot, data, counter);
+        if(height(joined) <= height(left->left) + 1)
+            return left;
 
-        return counter;
+        pStats.rotate();
+        return rotateLeft(left);
     }
 
     //---------------------------
 
-    void debugPrint() {
-        std::cout << "tree print:\n";
+    Node<Key, Data>* joinLeft(Node<Key, Data>* left, Node<Key, Data>* node, Node<Key, Data>* right) {
 
-        pDCount = 0;
+        Node<Key, Data>* spine = right->left;
 
-        if (pRoot != nullptr) {
+        if(height(spine) <= height(left) + 1) {
 
-            std::cout << "[+]={" + std::to_string(pRoot->key) + ":" + pRoot->data + "}\n";
-            debug(pRoot);
+            Node<Key, Data>* joined = this->link(left, node, spine);
+
+            if(height(joined) <= height(right->right) + 1)
+                return this->link(joined, right, right->right);
+
+            pStats.rotateTwice();
+            this->link(rotateLeft(joined), right, right->right);
+            return rotateRight(right);
         }
-    }
 
-    //---------------------------
+        Node<Key, Data>* joined = this->joinLeft(left, node, spine);
+        this->link(joined, right, right->right);
 
-private:
+        if(height(joined) <= height(right->right) + 1)
+            return right;
 
-    Node<Key, Data>* pRoot;
-    int pDCount;
+        pStats.rotate();
+        return rotateRight(right);
+    }
 
     //---------------------------
 
-    void debug(Node<Key, Data>* node) {
+    // Cuts root into the keys less than key, the node of key itself (if any) and the keys greater than key, O(log n)
+    void splitTree(Node<Key, Data>* root, const Key& key, Node<Key, Data>*& left, Node<Key, Data>*& found, Node<Key, Data>*& right) {
 
-        pDCount += 2;
+        if(!root) {
+            left = found = right = nullptr;
+            return;
+        }
 
-        if (node != nullptr) {
+        Node<Key, Data>* rest;
 
-            std::string str = "";
-            for (int i = 0; i < pDCount; ++i)
-                str += " ";
+        if(this->less(key, root->key)) {
+            this->splitTree(root->left, key, left, found, rest);
+            right = this->joinTree(rest, root, root->right);
+        }
 
-            if (node->left != nullptr)
-                std::cout << str + "[L]={" + std::to_string(node->left->key) + ":" + node->left->data + "}\n";
+        else if(this->less(root->key, key)) {
+            this->splitTree(root->right, key, rest, found, right);
+            left = this->joinTree(root->left, root, rest);
+        }
 
-            debug(node->left);
+        else {
+            left = root->left;
+            right = root->right;
+            found = this->link(nullptr, root, nullptr);
 
-            if (node->right != nullptr)
-                std::cout << str + "[R]={" + std::to_string(node->right->key) + ":" + node->right->data + "}\n";
+            if(left)
+                left->parent = nullptr;
 
-            debug(node->right);
+            if(right)
+                right->parent = nullptr;
         }
-
-        pDCount -= 2;
     }
 
     //---------------------------
 
-    void preorderFind(Node<Key, Data>* node, const Data& data, size_t& count) {
+    // Unlinks the largest node of root into last and returns the rest
+    Node<Key, Data>* splitLast(Node<Key, Data>* root, Node<Key, Data>*& last) {
 
-        if(!node) return;
+        if(!root->right) {
 
-        if(node->data == data)
-            ++count;
+            last = root;
 
-        preorderFind(node->left, data, count);
-        preorderFind(node->right, data, count);
+            if(root->left)
+                root->left->parent = nullptr;
+
+            return root->left;
+        }
+
+        Node<Key, Data>* rest = this->splitLast(root->right, last);
+
+        return this->joinTree(root->left, root, rest);
     }
 
     //---------------------------
 
-    void tree(Node<Key, Data>* node, std::vector<DataS<Key, Data>> &data) {
-        pDCount++;
+    // join without a middle key
+    Node<Key, Data>* concatTree(Node<Key, Data>* left, Node<Key, Data>* right) {
 
-        if (node != nullptr) {
+        if(!left)
+            return right;
 
-            std::string str = "";
-            for (int i = 0; i < pDCount; ++i)
-                str += "-";
+        if(!right)
+            return left;
 
-            if (node->left != nullptr) {
+        Node<Key, Data>* last;
+        left = this->splitLast(left, last);
 
-                DataS<Key, Data> buff;
-                buff.level = pDCount;
-                buff.state = 1;
-                buff.node = node->left;
+        return this->joinTree(left, last, right);
+    }
 
-                data.push_back(buff);
-            }
+    //---------------------------
 
-            tree(node->left, data);
+    // The root of other splits this tree, the halves recurse independently and join back through that key
+    Node<Key, Data>* unionTree(Node<Key, Data>* root, const Node<Key, Data>* other, SetContext& context, int forks) {
 
-            if (node->right != nullptr) {
+        if(!other)
+            return root;
 
-                DataS<Key, Data> buff;
-                buff.level = pDCount;
-                buff.state = 2;
-                buff.node = node->right;
+        if(!root)
+            return copyTree(other, context);
 
-                data.push_back(buff);
-            }
+        Node<Key, Data>* left;
+        Node<Key, Data>* found;
+        Node<Key, Data>* right;
 
-            tree(node->right, data);
-        }
+        int size = std::min(root->height, other->height);
+        this->splitTree(root, other->key, left, found, right);
+
+        forkJoin(context, forks, size,
+            [&](SetContext& side, int rest) { left = this->unionTree(left, other->left, side, rest); },
+            [&](SetContext& side, int rest) { right = this->unionTree(right, other->right, side, rest); });
 
-        pDCount--;
+        if(!found)
+            found = copyNode(other, context);
+
+        return this->joinTree(left, found, right);
     }
 
     //---------------------------
 
-    void printHorizontal(Node<Key, Data>* node, std::string& data) {
+    Node<Key, Data>* intersectTree(Node<Key, Data>* root, const Node<Key, Data>* other, SetContext& context, int forks) {
 
-        if(!node)
-            return;
+        if(!root)
+            return nullptr;
 
-        std::queue<Node<Key, Data>*> q;
-        q.push(node);
+        if(!other) {
+            collect(root, context);
+            return nullptr;
+        }
 
-        while (!q.empty()) {
-            Node<Key, Data>* current = q.front();
-            q.pop();
+        Node<Key, Data>* left;
+        Node<Key, Data>* found;
+        Node<Key, Data>* right;
 
-            data += std::to_string(current->key) + " ";
+        int size = std::min(root->height, other->height);
+        this->splitTree(root, other->key, left, found, right);
 
-            if (current->left) q.push(current->left);
-            if (current->right) q.push(current->right);
-        }
+        forkJoin(context, forks, size,
+            [&](SetContext& side, int rest) { left = this->intersectTree(left, other->left, side, rest); },
+            [&](SetContext& side, int rest) { right = this->intersectTree(right, other->right, side, rest); });
+
+        return found ? this->joinTree(left, found, right) : this->concatTree(left, right);
     }
 
     //---------------------------
 
-    void printVertical(Node<Key, Data>* node, std::string& data) {
-
-        if(!node)
-            return;
-
-        std::map<int, std::vector<Node<Key, Data>*>> nodes;
-        std::queue<std::pair<Node<Key, Data>*, int>> q; //  -     
-        q.push({node, 0});
+    Node<Key, Data>* differenceTree(Node<Key, Data>* root, const Node<Key, Data>* other, SetContext& context, int forks) {
 
-        while (!q.empty()) {
-            auto current = q.front();
-            q.pop();
-            Node<Key, Data>* node = current.first;
-            int level = current.second;
+        if(!root || !other)
+            return root;
 
-            nodes[level].push_back(node);
+        Node<Key, Data>* left;
+        Node<Key, Data>* found;
+        Node<Key, Data>* right;
 
-            if (node->left) q.push({node->left, level - 1});
-            if (node->right) q.push({node->right, level + 1});
-        }
-
-        //      
-        for (const auto& pair : nodes) {
-            for (const auto& val : pair.second) {
-                data += std::to_string(val->key) + " ";
-            }
-            data += "\n"; //     
-        }
+        int size = std::min(root->height, other->height);
+        this->splitTree(root, other->key, left, found, right);
 
-    }
+        forkJoin(context, forks, size,
+            [&](SetContext& side, int rest) { left = this->differenceTree(left, other->left, side, rest); },
+            [&](SetContext& side, int rest) { right = this->differenceTree(right, other->right, side, rest); });
 
-    void inorder(Node<Key, Data>* node, std::string& data) {
-        if(!node) return;
+        if(found)
+            context.removed.push_back(found);
 
-        inorder(node->left, data);
-        data += "{" + std::to_string(node->key) + ":" + node->data + "} --> ";
-        inorder(node->right, data);
+        return this->concatTree(left, right);
     }
 
     //---------------------------
 
-    void preorder(Node<Key, Data>* node, std::string& data) {
+    static Node<Key, Data>* leftmost(Node<Key, Data>* node) {
 
-        if(!node) return;
+        if(node)
+            while(node->left)
+                node = node->left;
 
-        data += "{" + std::to_string(node->key) + ":" + node->data + "} --> ";
-        preorder(node->left, data);
-        preorder(node->right, data);
+        return node;
     }
 
     //---------------------------
 
-    void postorder(Node<Key, Data>* node, std::string& data) {
-        if(!node) return;
+    static Node<Key, Data>* rightmost(Node<Key, Data>* node) {
 
-        preorder(node->left, data);
-        preorder(node->right, data);
+        if(node)
+            while(node->right)
+                node = node->right;
 
-        data += "{" + std::to_string(node->key) + ":" + node->data + "} --> ";
+        return node;
     }
 
-    void removeAll(Node<Key, Data>* node) {
-        if(node != nullptr) {
-            removeAll(node->left);
-            removeAll(node->right);
+    //---------------------------
 
-            delete node;
-            node = nullptr;
-        }
-    }
+    static Node<Key, Data>* successor(Node<Key, Data>* node) {
 
-    Node<Key, Data>* addNode(const std::pair<Key, Data>& item, Node<Key, Data>* node, bool& contains) {
+        if(node->right)
+            return leftmost(node->right);
 
-        if (!node) {
-            node = new Node<Key, Data>();
+        while(node->parent && node->parent->right == node)
+            node = node->parent;
 
-            node->key = item.first;
-            node->data = item.second;
-        }
+        return node->parent;
+    }
 
-        else if ( item.first < node->key)
-            node->left = addNode(item, node->left, contains);
+    //---------------------------
 
-        else if ( item.first > node->key )
-            node->right = addNode(item, node->right, contains);
+    static Node<Key, Data>* predecessor(Node<Key, Data>* node) {
 
-        else
-            contains = true;
+        if(node->left)
+            return rightmost(node->left);
 
-        return balance(node);
+        while(node->parent && node->parent->left == node)
+            node = node->parent;
+
+        return node->parent;
     }
 
     //---------------------------
@@ -416,6 +2229,8 @@ private:
     //---------------------------
 
     void fixHeight(Node<Key, Data>* p) {
+        pStats.fixHeight();
+
         unsigned char   hl = height(p->left),
                         hr = height(p->right);
 
@@ -430,6 +2245,12 @@ private:
         p->left = q->right;
         q->right = p;
 
+        if(p->left)
+            p->left->parent = p;
+
+        q->parent = p->parent;
+        p->parent = q;
+
         this->fixHeight(p);
         this->fixHeight(q);
 
@@ -445,6 +2266,12 @@ private:
         q->right = p->left;
         p->left = q;
 
+        if(q->right)
+            q->right->parent = q;
+
+        p->parent = q->parent;
+        q->parent = p;
+
         this->fixHeight(q);
         this->fixHeight(p);
 
@@ -458,85 +2285,305 @@ private:
         this->fixHeight(p);
 
         if( this->balanceFactor(p) == 2 ) {
-            if( this->balanceFactor(p->right) < 0 )
+            if( this->balanceFactor(p->right) < 0 ) {
                 p->right = rotateRight(p->right);
-            return rotateLeft(p);
+                pStats.rotateTwice();
+            } else
+                pStats.rotate();
+            return this->logChange(MapChangeType::Rotated, rotateLeft(p));
         }
 
         if( balanceFactor(p) == -2 ) {
-            if( balanceFactor(p->left) > 0  )
+            if( balanceFactor(p->left) > 0  ) {
                 p->left = rotateLeft(p->left);
-            return rotateRight(p);
+                pStats.rotateTwice();
+            } else
+                pStats.rotate();
+            return this->logChange(MapChangeType::Rotated, rotateRight(p));
         }
         return p; //   
     }
 
     //---------------------------
 
-    Node<Key, Data>* findMin(Node<Key, Data>* node) {
-        return node->left != nullptr ? findMin(node->left) : node;
+    // Rebalances the links on the path bottom-up and stops as soon as a subtree keeps its old height:
+    // nothing above it can change then. A path that started below the root (a finger search) goes on
+    // from above, the parent of its first node, through the parent links
+    void retrace(Node<Key, Data>** path[], int depth, Node<Key, Data>* above = nullptr) {
+
+        while(depth > 0) {
+
+            Node<Key, Data>** link = path[--depth];
+            Node<Key, Data>* node = *link;
+
+            unsigned char oldHeight = node->height;
+
+            node = balance(node);
+            *link = node;
+
+            if(node->height == oldHeight)
+                return;
+        }
+
+        while(above) {
+
+            Node<Key, Data>** link = this->linkTo(above);
+            unsigned char oldHeight = above->height;
+
+            Node<Key, Data>* node = balance(above);
+            *link = node;
+
+            if(node->height == oldHeight)
+                return;
+
+            above = node->parent;
+        }
     }
 
     //---------------------------
 
-    Node<Key, Data>* removeMin(Node<Key, Data>* node) {
-        if (node->left == nullptr)
-            return node->right;
+    // The link that points to node, in its parent or pRoot
+    Node<Key, Data>** linkTo(Node<Key, Data>* node) {
 
-        node->left = removeMin(node->left);
-        return balance(node);
+        Node<Key, Data>* parent = node->parent;
+
+        if(!parent)
+            return &pRoot;
+
+        return parent->left == node ? &parent->left : &parent->right;
     }
 
     //---------------------------
 
-    Node<Key, Data>* remove(Node<Key, Data>* node, const Key& key, bool& contains) {
-        if (!node)
-            return nullptr;
+    // Where a search for key begins: the root, or with finger search on the lowest ancestor of the finger
+    // whose subtree spans key. Going up through a parent on the same side as key says nothing, the subtree
+    // below is already known to reach past the finger that way; a parent on the other side bounds it
+    template <class K>
+    Node<Key, Data>* searchStart(const K& key) {
 
-        if ( key < node->key )
-            node->left = remove(node->left, key, contains);
+        Node<Key, Data>* node = pFinger;
 
-        else if ( key > node->key )
-            node->right = remove(node->right, key, contains);
+        if(!pFingerSearch || !node)
+            return pRoot;
 
-        else {
-            contains = true;
-            Node<Key, Data> *left = node->left,
-                            *right = node->right;
+        bool below = this->less(key, node->key);
 
-            delete node;
-            node = nullptr;
+        if(!below && !this->less(node->key, key))
+            return node;
 
-            if (!right) return left;
+        while(Node<Key, Data>* parent = node->parent) {
 
-            Node<Key, Data>* min = findMin(right);
-            min->right = removeMin(right);
-            min->left = left;
+            if(below ? parent->right == node && !this->less(key, parent->key)
+                     : parent->left == node && !this->less(parent->key, key))
+                return parent;
 
-            return balance(min);
+            node = parent;
         }
 
-        return balance(node);
+        return node;
+    }
+
+    //---------------------------
+
+    void touch(Node<Key, Data>* node) {
+        if(pFingerSearch)
+            pFinger = node;
+    }
+
+    //---------------------------
+
+    // Drops what points at nodes of the tree for quick access, before the nodes go away or change owner
+    void forgetNodes() {
+        pCache.clear();
+        pFinger = nullptr;
+        this->logRebuild();
     }
 
     //---------------------------
 
-    Node<Key, Data>* getNode(const Key& key) {
+    Node<Key, Data>* logChange(MapChangeType type, Node<Key, Data>* node) {
+
+        if(pLogChanges)
+            pChanges.push_back({ type, node, node->key });
 
-        Node<Key, Data>* node = findNode(pRoot, key);
         return node;
     }
 
     //---------------------------
 
-    Node<Key, Data>* findNode(Node<Key, Data>* node, const Key& key) {
-        if(!node || key == node->key)
+    // Whatever was logged before no longer tells how to get to the new shape
+    void logRebuild() {
+
+        if(!pLogChanges)
+            return;
+
+        pChanges.clear();
+        pChanges.push_back({ MapChangeType::Rebuilt, nullptr, Key() });
+    }
+
+    //---------------------------
+
+    bool removeNode(const Key& key) {
+
+        Node<Key, Data>* start = this->searchStart(key);
+        Node<Key, Data>* above = start ? start->parent : nullptr;
+
+        Node<Key, Data>** path[maxPathLength];
+        Node<Key, Data>** link = start ? this->linkTo(start) : &pRoot;
+        int depth = 0;
+
+        while(true) {
+
+            Node<Key, Data>* node = *link;
+            if(!node) {
+                pStats.walk(depth);
+
+                if(depth > 0)
+                    this->touch(*path[depth - 1]);
+
+                return false;
+            }
+
+            path[depth++] = link;
+
+            if(this->less(key, node->key))
+                link = &node->left;
+
+            else if(this->less(node->key, key))
+                link = &node->right;
+
+            else
+                break;
+        }
+
+        pStats.walk(depth);
+
+        Node<Key, Data>* node = *link;
+
+        if(!node->right) {
+
+            // The left subtree is already balanced and just moves up
+            *link = node->left;
+            --depth;
+
+            if(node->left)
+                node->left->parent = node->parent;
+
+        } else {
+
+            // Replace the node by the minimum of its right subtree
+            int nodeDepth = depth - 1;
+
+            Node<Key, Data>** minLink = &node->right;
+            while((*minLink)->left) {
+                path[depth++] = minLink;
+                minLink = &(*minLink)->left;
+            }
+
+            Node<Key, Data>* min = *minLink;
+            *minLink = min->right;
+
+            if(min->right)
+                min->right->parent = min->parent == node ? min : min->parent;
+
+            min->left = node->left;
+            min->right = node->right;
+            min->height = node->height;
+            min->parent = node->parent;
+
+            if(min->left)
+                min->left->parent = min;
+
+            if(min->right)
+                min->right->parent = min;
+
+            *link = min;
+
+            if(depth > nodeDepth + 1)
+                path[nodeDepth + 1] = &min->right;
+        }
+
+        // The next key is likely close to this one, the finger moves to what took the place of node
+        Node<Key, Data>* neighbour = *link ? *link : node->parent;
+
+        if(pLogChanges) {
+            pChanges.push_back({ MapChangeType::Removed, nullptr, node->key });
+
+            if(*link)
+                this->logChange(MapChangeType::Moved, *link);
+        }
+
+        pIndex.erase(node->data);
+        freeNode(node);
+
+        retrace(path, depth, above);
+
+        if(neighbour)
+            this->touch(neighbour);
+
+        return true;
+    }
+
+    //---------------------------
+
+    // Key order of the lookups, counted when Stats is on
+    template <class A, class B>
+    bool less(const A& a, const B& b) const {
+        pStats.compare();
+        return a < b;
+    }
+
+    //---------------------------
+
+    // Only lookups by Key go through the cache, another key type might hash differently
+    Node<Key, Data>* cached(const Key& key) {
+        return pCache.find(key);
+    }
+
+    template <class K>
+    Node<Key, Data>* cached(const K&) {
+        return nullptr;
+    }
+
+    //---------------------------
+
+    template <class K>
+    Node<Key, Data>* getNode(const K& key) {
+
+        Node<Key, Data>* node = this->cached(key);
+        if(node) {
+            this->touch(node);
             return node;
+        }
 
-        if( key < node->key )
-            return findNode(node->left, key);
-        else
-            return findNode(node->right, key);
+        node = this->searchStart(key);
+        Node<Key, Data>* last = node;
+        unsigned depth = 0;
+
+        while(node) {
+
+            last = node;
+            ++depth;
+
+            if(this->less(key, node->key))
+                node = node->left;
+
+            else if(this->less(node->key, key))
+                node = node->right;
+
+            else
+                break;
+        }
+
+        pStats.walk(depth);
+
+        if(node)
+            pCache.insert(node);
+
+        if(last)
+            this->touch(node ? node : last);
+
+        return node;
     }
 };
 
@@ -0,0 +1,484 @@
+//---------------------------
+
+#ifndef MAPFILE_HPP_INCLUDED
+#define MAPFILE_HPP_INCLUDED
+
+//---------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#if !defined(_WIN32)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+//---------------------------
+
+/*
+ * Binary snapshot format of Map (Map::save() / Map::load()).
+ *
+ * A 64-byte header is followed by one fixed-size record per node in postorder,
+ * so both children of a record come before it and the root is the last one.
+ * Links are record indices. The checksum covers the record array, which is
+ * laid out exactly as in memory: a file can be mapped and searched in place
+ * (MappedMap) or turned back into a tree in one pass without comparisons.
+ * Keys and data must be trivially copyable, files are not portable between
+ * byte orders (the loader rejects them).
+ */
+
+//---------------------------
+
+struct MapFileHeader {
+
+    static constexpr uint32_t currentVersion = 1;
+    static constexpr uint32_t byteOrderMark = 0x01020304;
+
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t keySize,
+             dataSize,
+             recordSize;
+    uint32_t root;
+    uint64_t count;
+    uint64_t checksum;
+    uint8_t reserved[16];
+};
+
+static_assert(sizeof(MapFileHeader) == 64, "the records start on the second cache line");
+
+//---------------------------
+
+template <class Key, class Data>
+struct MapFileRecord {
+
+    static constexpr uint32_t noLink = 0xFFFFFFFFu;
+
+    uint32_t left;
+    uint32_t right;
+
+    Key key;
+    Data data;
+
+    unsigned char height;
+};
+
+//---------------------------
+
+// Word-wise multiply-rotate hash of the record bytes. Every update() but the last must be a multiple of 8 bytes long
+class MapFileChecksum {
+public:
+
+    void update(const void* bytes, size_t length) {
+
+        const unsigned char* p = static_cast<const unsigned char*>(bytes);
+
+        for(; length >= 8; p += 8, length -= 8) {
+
+            uint64_t word;
+            std::memcpy(&word, p, 8);
+
+            this->mix(word);
+        }
+
+        if(length > 0) {
+
+            uint64_t word = 0;
+            std::memcpy(&word, p, length);
+
+            this->mix(word);
+        }
+    }
+
+    uint64_t get() const {
+        return pHash ^ (pHash >> 29);
+    }
+
+private:
+
+    uint64_t pHash = 0x9E3779B97F4A7C15ull;
+
+    void mix(uint64_t word) {
+        pHash ^= word * 0xC2B2AE3D27D4EB4Full;
+        pHash = ((pHash << 31) | (pHash >> 33)) * 0x9E3779B97F4A7C15ull;
+    }
+};
+
+//---------------------------
+
+inline void mapFileMagic(char* magic) {
+    std::memcpy(magic, "AVLMAP\0\0", 8);
+}
+
+//---------------------------
+
+// Streams records into a file through a block buffer, the header is written last
+template <class Key, class Data>
+class MapFileWriter {
+public:
+
+    typedef MapFileRecord<Key, Data> Record;
+
+    static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Data>::value,
+                  "the snapshot format stores keys and data as raw bytes");
+
+    explicit MapFileWriter(const char* path) : pBlock(blockRecords) {
+
+        pFile = std::fopen(path, "wb");
+
+        MapFileHeader header = {};
+        if(pFile && std::fwrite(&header, sizeof(header), 1, pFile) != 1)
+            this->fail();
+    }
+
+    ~MapFileWriter() {
+        if(pFile)
+            std::fclose(pFile);
+    }
+
+    MapFileWriter(const MapFileWriter&) = delete;
+    MapFileWriter& operator=(const MapFileWriter&) = delete;
+
+    //---------------------------
+
+    ///Appends a record and returns its index
+    uint32_t append(const Key& key, const Data& data, unsigned char height, uint32_t left, uint32_t right) {
+
+        if(pUsed == blockRecords)
+            this->flushBlock();
+
+        Record& record = pBlock[pUsed++];
+
+        std::memset(&record, 0, sizeof(Record)); // padding goes into the checksum too
+
+        record.left = left;
+        record.right = right;
+        record.key = key;
+        record.data = data;
+        record.height = height;
+
+        return static_cast<uint32_t>(pCount++);
+    }
+
+    //---------------------------
+
+    ///Writes the header and closes the file, false if anything failed on the way
+    bool finish(uint32_t root) {
+
+        this->flushBlock();
+
+        if(!pFile)
+            return false;
+
+        MapFileHeader header = {};
+
+        mapFileMagic(header.magic);
+        header.version = MapFileHeader::currentVersion;
+        header.byteOrder = MapFileHeader::byteOrderMark;
+        header.keySize = sizeof(Key);
+        header.dataSize = sizeof(Data);
+        header.recordSize = sizeof(Record);
+        header.root = root;
+        header.count = pCount;
+        header.checksum = pChecksum.get();
+
+        bool ok = std::fseek(pFile, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(header), 1, pFile) == 1;
+
+        ok = std::fclose(pFile) == 0 && ok;
+        pFile = nullptr;
+
+        return ok;
+    }
+
+    //---------------------------
+
+private:
+
+    static constexpr size_t blockRecords = 4096; // keeps every block but the last a multiple of 8 bytes
+
+    FILE* pFile = nullptr;
+
+    std::vector<Record> pBlock;
+    size_t pUsed = 0,
+           pCount = 0;
+
+    MapFileChecksum pChecksum;
+
+    //---------------------------
+
+    void flushBlock() {
+
+        if(pUsed == 0)
+            return;
+
+        pChecksum.update(pBlock.data(), pUsed * sizeof(Record));
+
+        if(pFile && std::fwrite(pBlock.data(), sizeof(Record), pUsed, pFile) != pUsed)
+            this->fail();
+
+        pUsed = 0;
+    }
+
+    //---------------------------
+
+    void fail() {
+        std::fclose(pFile);
+        pFile = nullptr;
+    }
+};
+
+//---------------------------
+
+#if defined(_WIN32)
+
+// Defined in MapFileWin32.cpp, so <windows.h> stays out of everything that includes Map.hpp
+const unsigned char* mapFileView(const char* path, size_t& size);
+void unmapFileView(const unsigned char* data, size_t size);
+
+#else
+
+///Maps the whole file read-only, null for a missing or empty one
+inline const unsigned char* mapFileView(const char* path, size_t& size) {
+
+    const unsigned char* view = nullptr;
+
+    int file = ::open(path, O_RDONLY);
+    if(file < 0)
+        return nullptr;
+
+    struct stat info;
+    if(fstat(file, &info) == 0 && info.st_size > 0) {
+
+        void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+
+        if(data != MAP_FAILED) {
+            view = static_cast<const unsigned char*>(data);
+            size = static_cast<size_t>(info.st_size);
+        }
+    }
+
+    ::close(file);
+
+    return view;
+}
+
+//---------------------------
+
+inline void unmapFileView(const unsigned char* data, size_t size) {
+    munmap(const_cast<unsigned char*>(data), size);
+}
+
+#endif
+
+//---------------------------
+
+// Read-only mapping of a whole file
+class MappedFile {
+public:
+
+    MappedFile() = default;
+    ~MappedFile() { this->close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    //---------------------------
+
+    bool open(const char* path) {
+
+        this->close();
+
+        pData = mapFileView(path, pSize);
+
+        return pData != nullptr;
+    }
+
+    //---------------------------
+
+    void close() {
+
+        if(!pData)
+            return;
+
+        unmapFileView(pData, pSize);
+
+        pData = nullptr;
+        pSize = 0;
+    }
+
+    //---------------------------
+
+    const unsigned char* getData() const {
+        return pData;
+    }
+
+    //---------------------------
+
+    size_t getSize() const {
+        return pSize;
+    }
+
+    //---------------------------
+
+private:
+
+    const unsigned char* pData = nullptr;
+    size_t pSize = 0;
+};
+
+//---------------------------
+
+/*
+ * A saved Map used in place: lookups walk the records of the mapped file, so
+ * opening costs the header check (plus one pass for the checksum and link
+ * validation when verify is set) regardless of the number of elements.
+ */
+template <class Key, class Data>
+class MappedMap {
+public:
+
+    typedef MapFileRecord<Key, Data> Record;
+
+    static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<Data>::value,
+                  "the snapshot format stores keys and data as raw bytes");
+
+    MappedMap() = default;
+
+    //---------------------------
+
+    ///Maps the file at path. Without verify the checksum and the links are trusted as they are
+    bool open(const char* path, bool verify = true) {
+
+        this->close();
+
+        if(!pFile.open(path) || !this->check(verify)) {
+            this->close();
+            return false;
+        }
+
+        return true;
+    }
+
+    //---------------------------
+
+    void close() {
+
+        pFile.close();
+
+        pRecords = nullptr;
+        pCount = 0;
+        pRoot = Record::noLink;
+    }
+
+    //---------------------------
+
+    const Data* get(const Key& key) const {
+
+        uint32_t index = pRoot;
+
+        while(index != Record::noLink) {
+
+            const Record& record = pRecords[index];
+
+            if(key < record.key)
+                index = record.left;
+
+            else if(record.key < key)
+                index = record.right;
+
+            else
+                return &record.data;
+        }
+
+        return nullptr;
+    }
+
+    //---------------------------
+
+    bool isOpen() const {
+        return pRecords != nullptr;
+    }
+
+    //---------------------------
+
+    size_t getSize() const {
+        return pCount;
+    }
+
+    //---------------------------
+
+    ///Records in postorder, the root is the last one
+    const Record* getRecords() const {
+        return pRecords;
+    }
+
+    //---------------------------
+
+private:
+
+    MappedFile pFile;
+
+    const Record* pRecords = nullptr;
+    size_t pCount = 0;
+    uint32_t pRoot = Record::noLink;
+
+    //---------------------------
+
+    bool check(bool verify) {
+
+        if(pFile.getSize() < sizeof(MapFileHeader))
+            return false;
+
+        MapFileHeader header;
+        std::memcpy(&header, pFile.getData(), sizeof(header));
+
+        char magic[8];
+        mapFileMagic(magic);
+
+        if(std::memcmp(header.magic, magic, 8) != 0 || header.version != MapFileHeader::currentVersion ||
+           header.byteOrder != MapFileHeader::byteOrderMark || header.keySize != sizeof(Key) ||
+           header.dataSize != sizeof(Data) || header.recordSize != sizeof(Record))
+            return false;
+
+        if(header.count >= Record::noLink || (pFile.getSize() - sizeof(MapFileHeader)) / sizeof(Record) != header.count)
+            return false;
+
+        if(header.count == 0 ? header.root != Record::noLink : header.root != header.count - 1)
+            return false;
+
+        const Record* records = reinterpret_cast<const Record*>(pFile.getData() + sizeof(MapFileHeader));
+
+        if(verify) {
+
+            MapFileChecksum checksum;
+            checksum.update(records, header.count * sizeof(Record));
+
+            if(checksum.get() != header.checksum)
+                return false;
+
+            // Postorder: every link points backwards, so lookups cannot loop or leave the array
+            for(uint32_t i = 0; i < header.count; ++i)
+                if((records[i].left != Record::noLink && records[i].left >= i) || (records[i].right != Record::noLink && records[i].right >= i))
+                    return false;
+        }
+
+        pRecords = records;
+        pCount = static_cast<size_t>(header.count);
+        pRoot = header.root;
+
+        return true;
+    }
+};
+
+//---------------------------
+
+#endif // MAPFILE_HPP_INCLUDED
+
+//---------------------------
@@ -0,0 +1,57 @@
+//---------------------------
+
+// Win32 side of MapFile.hpp, kept in its own translation unit so <windows.h>
+// and its macros do not reach the files that include Map.hpp
+
+#if defined(_WIN32)
+
+#ifndef NOMINMAX
+    #define NOMINMAX
+#endif
+
+#ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <windows.h>
+
+#include "MapFile.hpp"
+
+//---------------------------
+
+const unsigned char* mapFileView(const char* path, size_t& size) {
+
+    const unsigned char* view = nullptr;
+
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    LARGE_INTEGER fileSize;
+    if(GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+        if(mapping) {
+            view = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            CloseHandle(mapping);
+        }
+
+        if(view)
+            size = static_cast<size_t>(fileSize.QuadPart);
+    }
+
+    CloseHandle(file);
+
+    return view;
+}
+
+//---------------------------
+
+void unmapFileView(const unsigned char* data, size_t) {
+    UnmapViewOfFile(data);
+}
+
+#endif
+
+//---------------------------
@@ -0,0 +1,144 @@
+//---------------------------
+
+#ifndef MAPSTATS_HPP_INCLUDED
+#define MAPSTATS_HPP_INCLUDED
+
+//---------------------------
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//---------------------------
+
+///What Map::stats() reports, counted since construction or the last resetStats()
+struct MapCounters {
+
+    uint64_t comparisons = 0,
+             singleRotations = 0,
+             doubleRotations = 0,
+             heightFixes = 0,
+             allocations = 0,
+             frees = 0;   // nodes freed one by one, clear() drops whole slabs and is not counted
+
+    uint64_t walks = 0;   // add/get/remove paths that went into the depths
+    unsigned maxDepth = 0;
+    double averageDepth = 0.0;
+
+    ///One counter per line, for text overlays and logs
+    std::string toString() const {
+        return "comparisons: " + std::to_string(comparisons) +
+               "\nrotations: " + std::to_string(singleRotations) + " single, " + std::to_string(doubleRotations) + " double" +
+               "\nheight fixes: " + std::to_string(heightFixes) +
+               "\nnodes: " + std::to_string(allocations) + " allocated, " + std::to_string(frees) + " freed" +
+               "\ndepth: " + std::to_string(maxDepth) + " max, " + std::to_string(averageDepth).substr(0, 5) + " avg";
+    }
+};
+
+//---------------------------
+
+/*
+ * Operation counters kept by Map when its Stats parameter is on.
+ * The set operations rotate on worker threads, so the counts are relaxed
+ * atomics. With Stats off every call is empty and the map carries no state.
+ */
+template <bool Enabled>
+class MapStats {
+public:
+
+    static constexpr bool enabled = true;
+
+    void compare() { bump(pComparisons); }
+    void rotate() { bump(pSingleRotations); }
+    void rotateTwice() { bump(pDoubleRotations); }
+    void fixHeight() { bump(pHeightFixes); }
+    void allocate(uint64_t count = 1) { pAllocations.fetch_add(count, std::memory_order_relaxed); }
+    void free() { bump(pFrees); }
+
+    ///Length of the root-to-node path one operation walked
+    void walk(unsigned depth) {
+
+        bump(pWalks);
+        pDepthSum.fetch_add(depth, std::memory_order_relaxed);
+
+        unsigned max = pMaxDepth.load(std::memory_order_relaxed);
+        while(depth > max && !pMaxDepth.compare_exchange_weak(max, depth, std::memory_order_relaxed)) {}
+    }
+
+    MapCounters get() const {
+
+        MapCounters counters;
+
+        counters.comparisons = pComparisons.load(std::memory_order_relaxed);
+        counters.singleRotations = pSingleRotations.load(std::memory_order_relaxed);
+        counters.doubleRotations = pDoubleRotations.load(std::memory_order_relaxed);
+        counters.heightFixes = pHeightFixes.load(std::memory_order_relaxed);
+        counters.allocations = pAllocations.load(std::memory_order_relaxed);
+        counters.frees = pFrees.load(std::memory_order_relaxed);
+        counters.walks = pWalks.load(std::memory_order_relaxed);
+        counters.maxDepth = pMaxDepth.load(std::memory_order_relaxed);
+
+        if(counters.walks > 0)
+            counters.averageDepth = static_cast<double>(pDepthSum.load(std::memory_order_relaxed)) / static_cast<double>(counters.walks);
+
+        return counters;
+    }
+
+    void reset() {
+
+        std::atomic<uint64_t>* counters[] = { &pComparisons, &pSingleRotations, &pDoubleRotations, &pHeightFixes,
+                                              &pAllocations, &pFrees, &pWalks, &pDepthSum };
+
+        for(std::atomic<uint64_t>* counter : counters)
+            counter->store(0, std::memory_order_relaxed);
+
+        pMaxDepth.store(0, std::memory_order_relaxed);
+    }
+
+private:
+
+    std::atomic<uint64_t> pComparisons{0},
+                          pSingleRotations{0},
+                          pDoubleRotations{0},
+                          pHeightFixes{0},
+                          pAllocations{0},
+                          pFrees{0},
+                          pWalks{0},
+                          pDepthSum{0};
+
+    std::atomic<unsigned> pMaxDepth{0};
+
+    static void bump(std::atomic<uint64_t>& counter) {
+        counter.fetch_add(1, std::memory_order_relaxed);
+    }
+};
+
+//---------------------------
+
+template <>
+class MapStats<false> {
+public:
+
+    static constexpr bool enabled = false;
+
+    void compare() {}
+    void rotate() {}
+    void rotateTwice() {}
+    void fixHeight() {}
+    void allocate(uint64_t = 1) {}
+    void free() {}
+    void walk(unsigned) {}
+
+    MapCounters get() const {
+        return MapCounters();
+    }
+
+    void reset() {}
+};
+
+//---------------------------
+
+#endif // MAPSTATS_HPP_INCLUDED
+
+//---------------------------
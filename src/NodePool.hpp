@@ -0,0 +1,222 @@
+//---------------------------
+
+#ifndef NODEPOOL_HPP_INCLUDED
+#define NODEPOOL_HPP_INCLUDED
+
+//---------------------------
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+//---------------------------
+
+/*
+ * Slab allocator for tree nodes.
+ *
+ * Nodes are carved out of geometrically growing slabs, freed nodes go to an
+ * intrusive free list and are reused by the next allocate(). release() drops
+ * every slab at once, so clearing a tree does not need to visit its nodes
+ * (as long as they are trivially destructible).
+ *
+ * The slabs are held through a shared arena: adopt() lets one pool keep the
+ * slabs of another alive, which is what allows trees to hand nodes over.
+ * A whole tree moves with swap(), which cannot throw.
+ */
+template <class T>
+class NodePool {
+public:
+
+    static constexpr bool bulkRelease = true;
+
+    NodePool() = default;
+    ~NodePool() { this->release(); }
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    //---------------------------
+
+    T* allocate() {
+
+        if(pFree) {
+            Slot* slot = pFree;
+            pFree = slot->next;
+
+            return reinterpret_cast<T*>(slot);
+        }
+
+        if(pCursor == pEnd)
+            this->grow();
+
+        return reinterpret_cast<T*>(pCursor++);
+    }
+
+    //---------------------------
+
+    void deallocate(T* ptr) {
+
+        Slot* slot = reinterpret_cast<Slot*>(ptr);
+        slot->next = pFree;
+        pFree = slot;
+    }
+
+    //---------------------------
+
+    void release() noexcept {
+
+        pArena.reset();
+        pShared.clear();
+
+        pFree = nullptr;
+        pCursor = pEnd = nullptr;
+        pNextSlabSize = minSlabSize;
+    }
+
+    //---------------------------
+
+    ///The next count allocations come out of one block once the free list is used up:
+    ///when the current slab is short of count slots, a slab of exactly count slots replaces it
+    void reserve(size_t count) {
+
+        if(static_cast<size_t>(pEnd - pCursor) < count)
+            this->addSlab(count);
+    }
+
+    //---------------------------
+
+    ///Shares ownership of the memory of other, so nodes allocated by other may be kept after other is released
+    void adopt(NodePool& other) {
+
+        if(&other == this)
+            return;
+
+        this->share(other.pArena);
+
+        for(size_t i = 0; i < other.pShared.size(); ++i)
+            this->share(other.pShared[i]);
+    }
+
+    //---------------------------
+
+    ///Trades slabs, shared arenas and free slots with other
+    void swap(NodePool& other) noexcept {
+
+        std::swap(pArena, other.pArena);
+        std::swap(pShared, other.pShared);
+        std::swap(pFree, other.pFree);
+        std::swap(pCursor, other.pCursor);
+        std::swap(pEnd, other.pEnd);
+        std::swap(pNextSlabSize, other.pNextSlabSize);
+    }
+
+    //---------------------------
+
+    size_t getSlabCount() const {
+        return pArena ? pArena->slabs.size() : 0;
+    }
+
+    //---------------------------
+
+private:
+
+    union Slot {
+        Slot* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    static constexpr size_t minSlabSize = 64,
+                            maxSlabSize = 65536;
+
+    struct Arena {
+
+        std::vector<Slot*> slabs;
+
+        ~Arena() {
+            for(size_t i = 0; i < slabs.size(); ++i)
+                delete[] slabs[i];
+        }
+    };
+
+    std::shared_ptr<Arena> pArena;
+    std::vector<std::shared_ptr<Arena>> pShared;
+
+    Slot* pFree = nullptr;
+    Slot* pCursor = nullptr;
+    Slot* pEnd = nullptr;
+
+    size_t pNextSlabSize = minSlabSize;
+
+    //---------------------------
+
+    // Arenas go back and forth between maps that split and join again, each is held once
+    void share(const std::shared_ptr<Arena>& arena) {
+
+        if(!arena || arena == pArena)
+            return;
+
+        for(size_t i = 0; i < pShared.size(); ++i)
+            if(pShared[i] == arena)
+                return;
+
+        pShared.push_back(arena);
+    }
+
+    //---------------------------
+
+    void grow() {
+
+        this->addSlab(pNextSlabSize);
+
+        if(pNextSlabSize < maxSlabSize)
+            pNextSlabSize *= 2;
+    }
+
+    //---------------------------
+
+    void addSlab(size_t size) {
+
+        if(!pArena)
+            pArena = std::make_shared<Arena>();
+
+        Slot* slab = new Slot[size];
+        pArena->slabs.push_back(slab);
+
+        pCursor = slab;
+        pEnd = slab + size;
+    }
+};
+
+//---------------------------
+
+/*
+ * Plain new/delete allocation, one heap block per node.
+ */
+template <class T>
+class HeapNodeAllocator {
+public:
+
+    static constexpr bool bulkRelease = false;
+
+    T* allocate() {
+        return static_cast<T*>(::operator new(sizeof(T)));
+    }
+
+    void deallocate(T* ptr) {
+        ::operator delete(ptr);
+    }
+
+    void release() noexcept {}
+
+    void reserve(size_t) {}
+
+    void adopt(HeapNodeAllocator&) {}
+    void swap(HeapNodeAllocator&) noexcept {}
+};
+
+//---------------------------
+
+#endif // NODEPOOL_HPP_INCLUDED
+
+//---------------------------
@@ -0,0 +1,459 @@
+//---------------------------
+
+#ifndef PERSISTENTMAP_HPP_INCLUDED
+#define PERSISTENTMAP_HPP_INCLUDED
+
+//---------------------------
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Map.hpp"
+
+//---------------------------
+
+template <class Key, class Data>
+struct PersistentNode {
+
+    Key key;
+    Data data;
+
+    unsigned char height = 1;
+
+    const PersistentNode* left = nullptr;
+    const PersistentNode* right = nullptr;
+
+    mutable std::atomic<uint32_t> refs{1};
+};
+
+//---------------------------
+
+/*
+ * Persistent (fully versioned) AVL map.
+ *
+ * Nodes are immutable and reference counted. add/remove copy only the path
+ * to the change (O(log n) new nodes) and share everything else with the
+ * previous version, which goes to the undo history. A copy of the map or a
+ * snapshot() is one reference increment, and since the counts are atomic such
+ * copies can be handed to other threads. Undo/redo swap root pointers.
+ */
+template <class Key, class Data>
+class PersistentMap {
+public:
+
+    typedef PersistentNode<Key, Data> PNode;
+
+    PersistentMap() = default;
+
+    ///Shares the current version, the history is not copied
+    PersistentMap(const PersistentMap& other) : pRoot(retain(other.pRoot)) {}
+
+    PersistentMap(PersistentMap&& other) noexcept : pRoot(other.pRoot), pUndo(std::move(other.pUndo)), pRedo(std::move(other.pRedo)) {
+        other.pRoot = nullptr;
+    }
+
+    ///Copy and move assignment in one, the copy only takes a reference
+    PersistentMap& operator=(PersistentMap other) noexcept {
+
+        std::swap(pRoot, other.pRoot);
+        std::swap(pUndo, other.pUndo);
+        std::swap(pRedo, other.pRedo);
+
+        return *this;
+    }
+
+    ~PersistentMap() {
+
+        release(pRoot);
+        this->clearHistory();
+    }
+
+    //---------------------------
+
+    bool add(const Key& key, const Data& data) {
+        return this->add({ key, data });
+    }
+
+    //---------------------------
+
+    bool add(const std::pair<Key, Data>& pair) {
+
+        const PNode* root = insert(pRoot, pair);
+        if(!root)
+            return false;
+
+        this->commit(root);
+        return true;
+    }
+
+    //---------------------------
+
+    bool remove(const Key& key) {
+
+        bool removed = false;
+        const PNode* root = erase(pRoot, key, removed);
+
+        if(!removed)
+            return false;
+
+        this->commit(root);
+        return true;
+    }
+
+    //---------------------------
+
+    void clear() {
+
+        if(pRoot)
+            this->commit(nullptr);
+    }
+
+    //---------------------------
+
+    const Data* get(const Key& key) const {
+
+        const PNode* node = pRoot;
+
+        while(node) {
+
+            if(key < node->key)
+                node = node->left;
+
+            else if(node->key < key)
+                node = node->right;
+
+            else
+                return &node->data;
+        }
+
+        return nullptr;
+    }
+
+    //---------------------------
+
+    size_t getCountElement(Data data) const {
+
+        const PNode* stack[maxPathLength];
+        int depth = 0;
+        size_t counter = 0;
+
+        if(pRoot)
+            stack[depth++] = pRoot;
+
+        while(depth > 0) {
+
+            const PNode* node = stack[--depth];
+
+            if(node->data == data)
+                ++counter;
+
+            if(node->left) stack[depth++] = node->left;
+            if(node->right) stack[depth++] = node->right;
+        }
+
+        return counter;
+    }
+
+    //---------------------------
+
+    ///Same records as Map::getTree(), over copies owned by this map until the next getTree()
+    std::vector<DataS<Key, Data>> getTree() {
+        return exportTree(pRoot, pExport);
+    }
+
+    //---------------------------
+
+    ///The current version without the history, O(1)
+    PersistentMap snapshot() const {
+        return PersistentMap(*this);
+    }
+
+    //---------------------------
+
+    bool undo() {
+
+        if(pUndo.empty())
+            return false;
+
+        pRedo.push_back(pRoot);
+        pRoot = pUndo.back();
+        pUndo.pop_back();
+
+        return true;
+    }
+
+    //---------------------------
+
+    bool redo() {
+
+        if(pRedo.empty())
+            return false;
+
+        pUndo.push_back(pRoot);
+        pRoot = pRedo.back();
+        pRedo.pop_back();
+
+        return true;
+    }
+
+    //---------------------------
+
+    bool canUndo() const {
+        return !pUndo.empty();
+    }
+
+    //---------------------------
+
+    bool canRedo() const {
+        return !pRedo.empty();
+    }
+
+    //---------------------------
+
+    ///Drops the undo/redo versions, their nodes are freed unless another version still shares them
+    void clearHistory() {
+
+        for(size_t i = 0; i < pUndo.size(); ++i)
+            release(pUndo[i]);
+
+        for(size_t i = 0; i < pRedo.size(); ++i)
+            release(pRedo[i]);
+
+        pUndo.clear();
+        pRedo.clear();
+    }
+
+    //---------------------------
+
+private:
+
+    static constexpr int maxPathLength = 64;
+
+    const PNode* pRoot = nullptr;
+
+    std::vector<const PNode*> pUndo,
+                              pRedo;
+
+    std::vector<Node<Key, Data>> pExport;
+
+    //---------------------------
+
+    // Takes over the reference to root as the new current version
+    void commit(const PNode* root) {
+
+        pUndo.push_back(pRoot);
+        pRoot = root;
+
+        for(size_t i = 0; i < pRedo.size(); ++i)
+            release(pRedo[i]);
+
+        pRedo.clear();
+    }
+
+    //---------------------------
+
+    static const PNode* retain(const PNode* node) {
+
+        if(node)
+            node->refs.fetch_add(1, std::memory_order_relaxed);
+
+        return node;
+    }
+
+    //---------------------------
+
+    static void release(const PNode* node) {
+
+        if(node && node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+
+            release(node->left);
+            release(node->right);
+
+            delete node;
+        }
+    }
+
+    //---------------------------
+
+    static unsigned char height(const PNode* node) {
+        return node ? node->height : 0;
+    }
+
+    //---------------------------
+
+    // New node over the borrowed subtrees left and right, the caller owns the result
+    static const PNode* make(const Key& key, const Data& data, const PNode* left, const PNode* right) {
+
+        PNode* node = new PNode();
+
+        node->key = key;
+        node->data = data;
+        node->left = retain(left);
+        node->right = retain(right);
+
+        unsigned char hl = height(left),
+                      hr = height(right);
+
+        node->height = (hl > hr ? hl : hr) + 1;
+
+        return node;
+    }
+
+    //---------------------------
+
+    // make() that restores the AVL balance with new nodes instead of rotating shared ones
+    static const PNode* balance(const Key& key, const Data& data, const PNode* left, const PNode* right) {
+
+        unsigned char hl = height(left),
+                      hr = height(right);
+
+        if(hl > hr + 1) {
+
+            if(height(left->left) >= height(left->right)) {
+
+                const PNode* r = make(key, data, left->right, right);
+                const PNode* node = make(left->key, left->data, left->left, r);
+
+                release(r);
+                return node;
+            }
+
+            const PNode* mid = left->right;
+            const PNode* l = make(left->key, left->data, left->left, mid->left);
+            const PNode* r = make(key, data, mid->right, right);
+            const PNode* node = make(mid->key, mid->data, l, r);
+
+            release(l);
+            release(r);
+            return node;
+        }
+
+        if(hr > hl + 1) {
+
+            if(height(right->right) >= height(right->left)) {
+
+                const PNode* l = make(key, data, left, right->left);
+                const PNode* node = make(right->key, right->data, l, right->right);
+
+                release(l);
+                return node;
+            }
+
+            const PNode* mid = right->left;
+            const PNode* l = make(key, data, left, mid->left);
+            const PNode* r = make(right->key, right->data, mid->right, right->right);
+            const PNode* node = make(mid->key, mid->data, l, r);
+
+            release(l);
+            release(r);
+            return node;
+        }
+
+        return make(key, data, left, right);
+    }
+
+    //---------------------------
+
+    // Owned root of the new version, nullptr when the key is already there
+    static const PNode* insert(const PNode* node, const std::pair<Key, Data>& item) {
+
+        if(!node)
+            return make(item.first, item.second, nullptr, nullptr);
+
+        const PNode* result;
+
+        if(item.first < node->key) {
+
+            const PNode* left = insert(node->left, item);
+            if(!left)
+                return nullptr;
+
+            result = balance(node->key, node->data, left, node->right);
+            release(left);
+
+        } else if(node->key < item.first) {
+
+            const PNode* right = insert(node->right, item);
+            if(!right)
+                return nullptr;
+
+            result = balance(node->key, node->data, node->left, right);
+            release(right);
+
+        } else
+            return nullptr;
+
+        return result;
+    }
+
+    //---------------------------
+
+    // Owned root of the new version (may be empty), only meaningful when removed is set
+    static const PNode* erase(const PNode* node, const Key& key, bool& removed) {
+
+        if(!node)
+            return nullptr;
+
+        const PNode* result;
+
+        if(key < node->key) {
+
+            const PNode* left = erase(node->left, key, removed);
+            if(!removed)
+                return nullptr;
+
+            result = balance(node->key, node->data, left, node->right);
+            release(left);
+
+        } else if(node->key < key) {
+
+            const PNode* right = erase(node->right, key, removed);
+            if(!removed)
+                return nullptr;
+
+            result = balance(node->key, node->data, node->left, right);
+            release(right);
+
+        } else {
+
+            removed = true;
+
+            if(!node->right)
+                return retain(node->left);
+
+            const PNode* min = node->right;
+            while(min->left)
+                min = min->left;
+
+            const PNode* right = eraseMin(node->right);
+
+            result = balance(min->key, min->data, node->left, right);
+            release(right);
+        }
+
+        return result;
+    }
+
+    //---------------------------
+
+    static const PNode* eraseMin(const PNode* node) {
+
+        if(!node->left)
+            return retain(node->right);
+
+        const PNode* left = eraseMin(node->left);
+        const PNode* result = balance(node->key, node->data, left, node->right);
+
+        release(left);
+        return result;
+    }
+};
+
+//---------------------------
+
+#endif // PERSISTENTMAP_HPP_INCLUDED
+
+//---------------------------
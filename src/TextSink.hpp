@@ -0,0 +1,177 @@
+//---------------------------
+
+#ifndef TEXTSINK_HPP_INCLUDED
+#define TEXTSINK_HPP_INCLUDED
+
+//---------------------------
+
+#include <charconv>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+//---------------------------
+
+/*
+ * Buffered text output used by the Map traversals.
+ *
+ * Writes go into a buffer (the caller's one or a small internal one) which is
+ * flushed to a FILE* or appended to a std::string when it fills up. A sink over
+ * a plain caller buffer without a target stops at the end of the buffer and
+ * reports it through isTruncated(). Numbers are formatted with std::to_chars.
+ */
+class TextSink {
+public:
+
+    ///Output into buffer only, the text is not null-terminated (see getLength())
+    TextSink(char* buffer, size_t size) : pBuffer(buffer), pCapacity(size) {}
+
+    ///buffer is the staging area, flushed to file whenever it is full
+    TextSink(FILE* file, char* buffer, size_t size) : pBuffer(buffer), pCapacity(size), pFile(file) {}
+
+    explicit TextSink(FILE* file) : pBuffer(pLocal), pCapacity(sizeof(pLocal)), pFile(file) {}
+
+    ///Appends to out
+    explicit TextSink(std::string& out) : pBuffer(pLocal), pCapacity(sizeof(pLocal)), pString(&out) {}
+
+    ~TextSink() { this->flush(); }
+
+    TextSink(const TextSink&) = delete;
+    TextSink& operator=(const TextSink&) = delete;
+
+    //---------------------------
+
+    void write(const char* text, size_t length) {
+
+        while(length > 0) {
+
+            if(pLength == pCapacity && !this->drain())
+                return;
+
+            size_t n = pCapacity - pLength < length ? pCapacity - pLength : length;
+
+            std::memcpy(pBuffer + pLength, text, n);
+
+            pLength += n;
+            pTotal += n;
+            text += n;
+            length -= n;
+        }
+    }
+
+    //---------------------------
+
+    void write(const char* text) {
+        this->write(text, std::strlen(text));
+    }
+
+    //---------------------------
+
+    void write(const std::string& text) {
+        this->write(text.data(), text.size());
+    }
+
+    //---------------------------
+
+    void put(char symbol) {
+        this->write(&symbol, 1);
+    }
+
+    //---------------------------
+
+    template <class T>
+    void number(const T& value) {
+
+        char digits[64];
+        std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+
+        this->write(digits, static_cast<size_t>(result.ptr - digits));
+    }
+
+    //---------------------------
+
+    ///Characters go as they are, strings as text, other arithmetic values as numbers
+    template <class T>
+    void text(const T& value) {
+
+        if constexpr(std::is_same<T, char>::value || std::is_same<T, signed char>::value || std::is_same<T, unsigned char>::value)
+            this->put(static_cast<char>(value));
+
+        else if constexpr(std::is_arithmetic<T>::value)
+            this->number(value);
+
+        else
+            this->write(value);
+    }
+
+    //---------------------------
+
+    void flush() {
+
+        if(pLength == 0 || (!pFile && !pString))
+            return;
+
+        if(pFile)
+            std::fwrite(pBuffer, 1, pLength, pFile);
+        else
+            pString->append(pBuffer, pLength);
+
+        pLength = 0;
+    }
+
+    //---------------------------
+
+    ///Characters still in the buffer (everything written so far for a plain buffer sink)
+    size_t getLength() const {
+        return pLength;
+    }
+
+    //---------------------------
+
+    size_t getTotalLength() const {
+        return pTotal;
+    }
+
+    //---------------------------
+
+    bool isTruncated() const {
+        return pTruncated;
+    }
+
+    //---------------------------
+
+private:
+
+    char* pBuffer;
+    size_t pCapacity;
+    size_t pLength = 0,
+           pTotal = 0;
+
+    FILE* pFile = nullptr;
+    std::string* pString = nullptr;
+
+    bool pTruncated = false;
+
+    char pLocal[4096];
+
+    //---------------------------
+
+    bool drain() {
+
+        if(!pFile && !pString) {
+            pTruncated = true;
+            return false;
+        }
+
+        this->flush();
+        return true;
+    }
+};
+
+//---------------------------
+
+#endif // TEXTSINK_HPP_INCLUDED
+
+//---------------------------
@@ -0,0 +1,161 @@
+//---------------------------
+
+#ifndef TREEORDER_HPP_INCLUDED
+#define TREEORDER_HPP_INCLUDED
+
+//---------------------------
+
+#include <cstddef>
+#include <vector>
+
+//---------------------------
+
+/*
+ * Level-order and vertical-order engines for trees of nodes with left/right links.
+ *
+ * One breadth-first pass lists the nodes in a flat array that doubles as the
+ * queue and notes each node's column, which gives the column range. Vertical
+ * order is then a stable counting sort of that list into one bucket per
+ * column. The arrays are kept between runs, so an engine that has seen a tree
+ * of this size before does not allocate.
+ */
+template <class TNode>
+class TreeOrder {
+public:
+
+    ///Calls visit(const TNode&, int level) level by level, left to right inside a level
+    template <class Visitor>
+    void levelOrder(const TNode* root, Visitor visit) {
+
+        this->breadthFirst(root);
+
+        size_t levelEnd = pNodes.empty() ? 0 : 1;
+        int level = 0;
+
+        for(size_t i = 0; i < pNodes.size(); ++i) {
+
+            // The children of a level are exactly the nodes queued while it was read
+            if(i == levelEnd) {
+                levelEnd = pLevelEnds[level];
+                ++level;
+            }
+
+            visit(*pNodes[i], level);
+        }
+    }
+
+    //---------------------------
+
+    ///Calls visit(const TNode&, int column) column by column from the leftmost, the root is column 0.
+    ///Inside a column the nodes come in level order
+    template <class Visitor>
+    void verticalOrder(const TNode* root, Visitor visit) {
+
+        this->breadthFirst(root);
+
+        if(pNodes.empty())
+            return;
+
+        size_t width = static_cast<size_t>(pMaxColumn - pMinColumn) + 1;
+
+        pBuckets.assign(width + 1, 0);
+
+        for(size_t i = 0; i < pColumns.size(); ++i)
+            ++pBuckets[pColumns[i] - pMinColumn + 1];
+
+        for(size_t c = 1; c <= width; ++c)
+            pBuckets[c] += pBuckets[c - 1];
+
+        pSorted.resize(pNodes.size());
+
+        for(size_t i = 0; i < pNodes.size(); ++i)
+            pSorted[pBuckets[pColumns[i] - pMinColumn]++] = pNodes[i];
+
+        // Filling moved every bucket start to the bucket's end, so the ends tell the columns apart again
+        size_t column = 0;
+
+        for(size_t i = 0; i < pSorted.size(); ++i) {
+
+            while(i >= pBuckets[column])
+                ++column;
+
+            visit(*pSorted[i], static_cast<int>(column) + pMinColumn);
+        }
+    }
+
+    //---------------------------
+
+    ///Returns the kept arrays to the heap
+    void release() {
+        std::vector<const TNode*>().swap(pNodes);
+        std::vector<const TNode*>().swap(pSorted);
+        std::vector<int>().swap(pColumns);
+        std::vector<size_t>().swap(pBuckets);
+        std::vector<size_t>().swap(pLevelEnds);
+    }
+
+    //---------------------------
+
+private:
+
+    std::vector<const TNode*> pNodes,   // breadth-first order, also the queue
+                              pSorted;  // pNodes by column
+    std::vector<int> pColumns;          // column of pNodes[i]
+    std::vector<size_t> pBuckets,
+                        pLevelEnds;     // end of every level in pNodes but the first
+
+    int pMinColumn = 0,
+        pMaxColumn = 0;
+
+    //---------------------------
+
+    void breadthFirst(const TNode* root) {
+
+        pNodes.clear();
+        pColumns.clear();
+        pLevelEnds.clear();
+
+        pMinColumn = pMaxColumn = 0;
+
+        if(!root)
+            return;
+
+        pNodes.push_back(root);
+        pColumns.push_back(0);
+
+        size_t levelEnd = 1;
+
+        for(size_t i = 0; i < pNodes.size(); ++i) {
+
+            const TNode* node = pNodes[i];
+            int column = pColumns[i];
+
+            if(node->left) {
+                pNodes.push_back(node->left);
+                pColumns.push_back(column - 1);
+
+                if(column - 1 < pMinColumn)
+                    pMinColumn = column - 1;
+            }
+
+            if(node->right) {
+                pNodes.push_back(node->right);
+                pColumns.push_back(column + 1);
+
+                if(column + 1 > pMaxColumn)
+                    pMaxColumn = column + 1;
+            }
+
+            if(i + 1 == levelEnd && pNodes.size() > levelEnd) {
+                levelEnd = pNodes.size();
+                pLevelEnds.push_back(levelEnd);
+            }
+        }
+    }
+};
+
+//---------------------------
+
+#endif // TREEORDER_HPP_INCLUDED
+
+//---------------------------
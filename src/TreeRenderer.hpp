@@ -12,34 +12,31 @@
 #include <cmath>
 
 #include <bitset>
+#include <map>
 
 #include "Map.hpp"
+#include "TextSink.hpp"
 
 //---------------------------
 
+///One cell of the view. Its quad is packed into the vertex array of TreeRenderer, only the sign is drawn on its own
 template <class Key>
-class TreeRenderedItem : public sf::Drawable {
+class TreeRenderedItem {
 public:
 
     TreeRenderedItem(const Key& _key) : key(_key) {
         //
     }
 
-    int level  = 0,
-        offset = 0;
+    int level = 0;
+    uint64_t offset = 0;
+
+    size_t index = 0; // place in TreeRenderer::m_items
 
     sf::Vertex vertices[4];
     sf::Text sign;
 
-    const Key& key;
-
-private:
-
-    void draw(sf::RenderTarget& target, sf::RenderStates states) const {
-        target.draw(vertices, 4, sf::PrimitiveType::TriangleFan, states);
-        target.draw(sign, states);
-    }
-
+    Key key; // a copy, patched and reused items outlive the records they were built from
 };
 
 //---------------------------
@@ -65,8 +62,10 @@ public:
 
         m_sign.setFillColor(sf::Color::Black);
         m_helpScreenSign.setFillColor(sf::Color::Black);
+        m_statsSign.setFillColor(sf::Color::Black);
+        m_statsSign.setCharacterSize(14);
 
-        this->setControlKeySign("W) up\nS) down\nA) left\nD) right\nQ) remove\nE) add\nR) count items by data\nF1) inorder, preorder, postorder - print\nF2) Horizontal and Vertical print", "F", "Tab", "Enter");
+        this->setControlKeySign("W) up\nS) down\nA) left\nD) right\nQ) remove\nE) add\nR) count items by data\nT) operation counters\nF1) inorder, preorder, postorder - print\nF2) Horizontal and Vertical print", "F", "Tab", "Enter");
         this->setSize(450.0f, 320.0f);
         this->setBackgroundColor(sf::Color(128, 128, 128));
         this->deactivate();
@@ -76,6 +75,7 @@ public:
         m_helpScreen[2].color = m_helpScreen[0].color;
         m_helpScreen[3].color = m_helpScreen[0].color;
 
+        m_cells.setPrimitiveType(sf::PrimitiveType::Triangles);
     }
 
     //---------------------------
@@ -84,6 +84,7 @@ public:
 
         m_sign.setFont(font);
         m_helpScreenSign.setFont(font);
+        m_statsSign.setFont(font);
 
         for(size_t i = 0; i < m_items.size(); ++i)
             m_items[i]->sign.setFont(font);
@@ -116,6 +117,7 @@ public:
         this->setupHelpScreenSignBounds();
         this->resizeItems();
         this->setupSignBounds();
+        this->setupStatsSignBounds();
 
     }
 
@@ -157,8 +159,8 @@ public:
 
         if(m_selectedItem != nullptr) {
 
-            int targetLevel = std::min(std::max(0, m_selectedItem->level + vert), m_maxLevel - 1),
-                targetOffset = m_selectedItem->offset;
+            int targetLevel = std::min(std::max(0, m_selectedItem->level + vert), m_maxLevel - 1);
+            uint64_t targetOffset = m_selectedItem->offset;
 
             if(vert > 0)
                 targetOffset <<= vert;
@@ -166,21 +168,25 @@ public:
             else if(vert < 0)
                 targetOffset >>= -vert;
 
-            targetOffset += horz;
+            // Nothing lies left of offset 0, the selection stays instead of wrapping around
+            if(horz < 0 && targetOffset < static_cast<uint64_t>(-horz))
+                return;
 
-            for(size_t i = 0; i < m_items.size(); ++i) {
-                if(m_items[i]->level == targetLevel && (m_items[i]->offset == targetOffset || m_items[i]->offset == targetOffset + 1)) {
+            targetOffset += horz;
 
-                    m_selectedItem = m_items[i];
-                    m_animClock.restart();
+            // Patching does not keep m_items in preorder, so the left child (or nearer cell) is preferred by offset
+            const TreeRenderedItem<Key>* target = this->findItem(targetLevel, targetOffset);
+            if(target == nullptr)
+                target = this->findItem(targetLevel, targetOffset + 1);
 
-                    break;
-                }
+            if(target != nullptr) {
+                m_selectedItem = target;
+                m_animClock.restart();
             }
 
-        } else if(m_items.size() > 0) {
+        } else if(const TreeRenderedItem<Key>* root = this->findItem(0, 0)) {
 
-            m_selectedItem = m_items[0];
+            m_selectedItem = root;
             m_animClock.restart();
         }
 
@@ -235,6 +241,26 @@ public:
 
     //---------------------------
 
+    ///Text of the statistics overlay (Map::stats().toString(), say)
+    void setStatsSign(const std::string& stats) {
+        m_statsSign.setString(stats);
+        this->setupStatsSignBounds();
+    }
+
+    //---------------------------
+
+    void toggleStats() {
+        m_showStats = !m_showStats;
+    }
+
+    //---------------------------
+
+    bool isStatsShown() const {
+        return m_showStats;
+    }
+
+    //---------------------------
+
     void activate() {
         if(m_isActive)
             return;
@@ -411,7 +437,15 @@ public:
         for(size_t i = 0; i < m_items.size(); ++i)
             delete m_items[i];
 
+        for(size_t i = 0; i < m_spareItems.size(); ++i)
+            delete m_spareItems[i];
+
         m_items.clear();
+        m_spareItems.clear();
+        m_itemsByKey.clear();
+        m_levelCounts.clear();
+
+        m_cellsChanged = true;
     }
 
     //---------------------------
@@ -426,18 +460,17 @@ public:
             m_maxLevel = std::max(m_maxLevel, tree[i].level);
         ++m_maxLevel;
 
-        std::vector<int> offsets;
+        std::vector<uint64_t> offsets;
         offsets.resize(m_maxLevel);
 
         int currLevel = 0;
 
-        std::stringstream keyDataPair;
         for(size_t i = 0; i < tree.size(); ++i) {
 
             const DataS<Key, Data>& curr = tree[i];
             TreeRenderedItem<Key>* item = new TreeRenderedItem<Key>(curr.node->key);
 
-            int offset;
+            uint64_t offset;
             if(curr.level < currLevel) { // One tree's part is done -> next one
 
                 currLevel = curr.level;
@@ -457,21 +490,78 @@ public:
 
             }
 
-            keyDataPair.str("");
-            keyDataPair << curr.node->key;
-            keyDataPair << ": ";
-            keyDataPair << curr.node->data;
+            this->setupItemSign(item, curr.node->data);
+            this->addItem(item);
+            m_itemsByKey[item->key] = item;
 
-            item->sign.setString(keyDataPair.str());
-            item->level = curr.level;
+            this->setItemLevel(item, curr.level);
             item->offset = offset;
 
             //std::cout << curr.level << " " << curr.state << " " << std::bitset<8>(item->offset) << std::endl;
+        }
+
+        this->resizeItems();
+    }
+
+    //---------------------------
+
+    ///Builds the view from Map::exportLayout(): every item already has its level and offset.
+    ///The items of the last build are reused, only the ones beyond the old count are allocated
+    void buildFromLayout(const TreeLayout<Key, Data>& layout) {
+
+        m_selectedItem = nullptr;
+
+        // Items and key nodes of the last build are kept and used again, a build no larger than one before does not allocate
+        if(m_items.size() > layout.size()) {
+
+            m_spareItems.insert(m_spareItems.end(), m_items.begin() + layout.size(), m_items.end());
+            m_items.resize(layout.size());
+        }
+
+        m_items.reserve(layout.size());
+        m_spareKeyNodes.reserve(m_spareKeyNodes.size() + m_itemsByKey.size());
+
+        while(!m_itemsByKey.empty())
+            m_spareKeyNodes.push_back(m_itemsByKey.extract(m_itemsByKey.begin()));
+
+        m_maxLevel = std::max(layout.levelCount, 1);
+        m_levelCounts.assign(m_maxLevel, 0);
+
+        for(size_t i = 0; i < layout.size(); ++i) {
 
-            if(m_sign.getFont() != nullptr)
-                item->sign.setFont(*m_sign.getFont());
+            if(i == m_items.size()) {
 
-            m_items.push_back(item);
+                if(m_spareItems.empty())
+                    m_items.push_back(new TreeRenderedItem<Key>(layout.keys[i]));
+
+                else {
+                    m_items.push_back(m_spareItems.back());
+                    m_spareItems.pop_back();
+                }
+
+                m_items[i]->index = i;
+            }
+
+            TreeRenderedItem<Key>* item = m_items[i];
+
+            item->key = layout.keys[i];
+            item->level = layout.levels[i];
+            item->offset = layout.offsets[i];
+            ++m_levelCounts[item->level];
+
+            this->setupItemSign(item, layout.data[i]);
+
+            if(m_spareKeyNodes.empty())
+                m_itemsByKey.emplace(item->key, item);
+
+            else {
+                typename ItemsByKey::node_type node = std::move(m_spareKeyNodes.back());
+                m_spareKeyNodes.pop_back();
+
+                node.key() = item->key;
+                node.mapped() = item;
+                m_itemsByKey.insert(std::move(node));
+            }
         }
 
         this->resizeItems();
@@ -479,6 +569,39 @@ public:
 
     //---------------------------
 
+    ///Patches the items from the change log of the map (Map::setChangeLog): removed nodes lose their items and only
+    ///the subtrees that were inserted, rotated or moved are laid out again. The whole view is only resized when the
+    ///tree gets a level more or less. Returns false for a log with Rebuilt in it, the view has to be built again then
+    bool applyChanges(const std::vector<MapChange<Key, Data>>& changes) {
+
+        for(size_t i = 0; i < changes.size(); ++i)
+            if(changes[i].type == MapChangeType::Rebuilt)
+                return false;
+
+        int maxLevel = m_maxLevel;
+
+        for(size_t i = 0; i < changes.size(); ++i) {
+
+            const MapChange<Key, Data>& change = changes[i];
+
+            if(change.type == MapChangeType::Removed)
+                this->removeItem(change.key);
+
+            else if(change.node != nullptr) // null - removed later on, its place is in the log as well
+                this->layoutSubtree(change.node);
+        }
+
+        while(m_maxLevel > 1 && m_levelCounts[m_maxLevel - 1] == 0)
+            --m_maxLevel;
+
+        if(m_maxLevel != maxLevel)
+            this->resizeItems();
+
+        return true;
+    }
+
+    //---------------------------
+
     ~TreeRenderer() {
         this->clear();
     }
@@ -492,8 +615,19 @@ private:
 
     const size_t m_emptyFoundResult = static_cast<size_t>(-1);
 
+    typedef std::map<Key, TreeRenderedItem<Key>*> ItemsByKey;
+
     sf::Vector2f m_size;
     std::vector<TreeRenderedItem<Key>*> m_items;
+    ItemsByKey m_itemsByKey;
+    std::vector<TreeRenderedItem<Key>*> m_spareItems;            // items and map nodes buildFromLayout() keeps for the next build
+    std::vector<typename ItemsByKey::node_type> m_spareKeyNodes;
+    sf::String m_label; // item label scratch of setupItemSign()
+    std::vector<size_t> m_levelCounts; // items per level, tells when m_maxLevel shrinks
+
+    // The quads of all items as triangles, one draw call. draw() packs them again after the layout changed
+    mutable sf::VertexArray m_cells;
+    mutable bool m_cellsChanged = true;
 
     const TreeRenderedItem<Key>* m_selectedItem = nullptr;
     int m_maxLevel = 1;
@@ -508,6 +642,9 @@ private:
     sf::Vertex m_helpScreen[4];
     sf::Text m_helpScreenSign;
 
+    sf::Text m_statsSign;
+    bool m_showStats = false;
+
     std::string m_tmpValue,
                 m_helpSign,
                 m_keyHelp,
@@ -530,41 +667,209 @@ private:
      */
     void resizeItems() {
 
+        for(size_t i = 0; i < m_items.size(); ++i)
+            this->resizeItem(m_items[i]);
+
+        m_cellsChanged = true;
+    }
+
+    //---------------------------
+
+    void resizeItem(TreeRenderedItem<Key>* item) {
+
         sf::Vector2f currSize(m_size.x / this->getScale().x, m_size.y / this->getScale().y);
-        float itemHeight = currSize.y / m_maxLevel;
+
+        float itemHeight = currSize.y / m_maxLevel,
+              itemWidth = currSize.x / static_cast<float>(uint64_t(1) << item->level);
+
+        unsigned char comp = (item->level + 1) * 64 / m_maxLevel;
+
+        item->vertices[0].position.x = static_cast<float>(item->offset) * itemWidth;
+        item->vertices[0].position.y = item->level * itemHeight;
+
+        item->vertices[1].position.x = item->vertices[0].position.x + itemWidth;
+        item->vertices[1].position.y = item->vertices[0].position.y;
+
+        item->vertices[2].position.x = item->vertices[1].position.x;
+        item->vertices[2].position.y = item->vertices[1].position.y + itemHeight;
+
+        item->vertices[3].position.x = item->vertices[0].position.x;
+        item->vertices[3].position.y = item->vertices[2].position.y;
+
+        item->vertices[0].color = item->offset & 1 ? sf::Color(comp, comp, comp) : sf::Color(200, comp, comp);
+        item->vertices[1].color = item->vertices[0].color;
+        item->vertices[2].color = item->vertices[0].color;
+        item->vertices[3].color = item->vertices[0].color;
+
+        item->sign.setPosition((item->vertices[0].position.x + item->vertices[2].position.x) * 0.5f,
+                               (item->vertices[0].position.y + item->vertices[2].position.y) * 0.5f);
+        item->sign.setOrigin((item->sign.getLocalBounds().width - item->sign.getLocalBounds().left) * 0.5f,
+                              item->sign.getLocalBounds().height * 0.5f + item->sign.getLocalBounds().top);
+
+        m_cellsChanged = true;
+    }
+
+    //---------------------------
+
+    ///Quad i of the items becomes triangles 0-1-2 and 0-2-3 at m_cells[i * 6]
+    void packCells() const {
+
+        m_cells.resize(m_items.size() * 6);
 
         for(size_t i = 0; i < m_items.size(); ++i) {
 
-            float itemWidth = currSize.x / (1 << m_items[i]->level);
-            unsigned char comp = (m_items[i]->level + 1) * 64 / m_maxLevel;
+            const sf::Vertex* quad = m_items[i]->vertices;
+            sf::Vertex* cell = &m_cells[i * 6];
+
+            cell[0] = quad[0];
+            cell[1] = quad[1];
+            cell[2] = quad[2];
+            cell[3] = quad[0];
+            cell[4] = quad[2];
+            cell[5] = quad[3];
+        }
+
+        m_cellsChanged = false;
+    }
+
+    //---------------------------
+
+    void setupItemSign(TreeRenderedItem<Key>* item, const Data& data) {
+
+        // "key: data" through std::to_chars into the stack, longer labels are cut
+        char label[64];
+        TextSink sink(label, sizeof(label));
+
+        sink.text(item->key);
+        sink.write(": ", 2);
+        sink.text(data);
+
+        // One code point at a time into a kept sf::String: converting the whole label would allocate for each item
+        m_label.clear();
+        for(size_t i = 0; i < sink.getLength(); ++i)
+            m_label += sf::String(static_cast<sf::Uint32>(static_cast<unsigned char>(label[i])));
+
+        item->sign.setString(m_label);
+
+        if(m_sign.getFont() != nullptr)
+            item->sign.setFont(*m_sign.getFont());
+    }
+
+    //---------------------------
+
+    const TreeRenderedItem<Key>* findItem(int level, uint64_t offset) const {
+
+        for(size_t i = 0; i < m_items.size(); ++i)
+            if(m_items[i]->level == level && m_items[i]->offset == offset)
+                return m_items[i];
+
+        return nullptr;
+    }
+
+    //---------------------------
+
+    ///Takes a new item on level 0, m_itemsByKey is up to the caller
+    void addItem(TreeRenderedItem<Key>* item) {
+
+        if(m_levelCounts.empty())
+            m_levelCounts.resize(1, 0);
+
+        ++m_levelCounts[item->level];
+
+        item->index = m_items.size();
+        m_items.push_back(item);
+    }
+
+    //---------------------------
+
+    void setItemLevel(TreeRenderedItem<Key>* item, int level) {
+
+        if(static_cast<size_t>(level) >= m_levelCounts.size())
+            m_levelCounts.resize(level + 1, 0);
 
-            m_items[i]->vertices[0].position.x = m_items[i]->offset * itemWidth;
-            m_items[i]->vertices[0].position.y = m_items[i]->level * itemHeight;
+        --m_levelCounts[item->level];
+        ++m_levelCounts[level];
 
-            m_items[i]->vertices[1].position.x = m_items[i]->vertices[0].position.x + itemWidth;
-            m_items[i]->vertices[1].position.y = m_items[i]->vertices[0].position.y;
+        item->level = level;
+        m_maxLevel = std::max(m_maxLevel, level + 1);
+    }
+
+    //---------------------------
+
+    ///Lays out node and its subtree again, the place of node comes from its path to the root
+    void layoutSubtree(const Node<Key, Data>* node) {
+
+        int level = 0;
+        uint64_t offset = 0;
+
+        for(const Node<Key, Data>* curr = node; curr->parent != nullptr; curr = curr->parent, ++level)
+            if(curr == curr->parent->right)
+                offset |= uint64_t(1) << level;
+
+        struct Place {
+            const Node<Key, Data>* node;
+            int level;
+            uint64_t offset;
+        };
+
+        std::vector<Place> stack(1, Place{ node, level, offset });
+
+        while(!stack.empty()) {
+
+            Place curr = stack.back();
+            stack.pop_back();
 
-            m_items[i]->vertices[2].position.x = m_items[i]->vertices[1].position.x;
-            m_items[i]->vertices[2].position.y = m_items[i]->vertices[1].position.y + itemHeight;
+            TreeRenderedItem<Key>*& item = m_itemsByKey[curr.node->key];
 
-            m_items[i]->vertices[3].position.x = m_items[i]->vertices[0].position.x;
-            m_items[i]->vertices[3].position.y = m_items[i]->vertices[2].position.y;
+            if(item == nullptr) {
 
-            m_items[i]->vertices[0].color = m_items[i]->offset & 1 ? sf::Color(comp, comp, comp) : sf::Color(200, comp, comp);
-            m_items[i]->vertices[1].color = m_items[i]->vertices[0].color;
-            m_items[i]->vertices[2].color = m_items[i]->vertices[0].color;
-            m_items[i]->vertices[3].color = m_items[i]->vertices[0].color;
+                item = new TreeRenderedItem<Key>(curr.node->key);
 
-            m_items[i]->sign.setPosition((m_items[i]->vertices[0].position.x + m_items[i]->vertices[2].position.x) * 0.5f,
-                                         (m_items[i]->vertices[0].position.y + m_items[i]->vertices[2].position.y) * 0.5f);
-            m_items[i]->sign.setOrigin((m_items[i]->sign.getLocalBounds().width - m_items[i]->sign.getLocalBounds().left) * 0.5f,
-                                        m_items[i]->sign.getLocalBounds().height * 0.5f + m_items[i]->sign.getLocalBounds().top);
+                this->setupItemSign(item, curr.node->data);
+                this->addItem(item);
+            }
+
+            this->setItemLevel(item, curr.level);
+            item->offset = curr.offset;
+
+            this->resizeItem(item);
 
+            if(curr.node->left != nullptr)
+                stack.push_back({ curr.node->left, curr.level + 1, curr.offset * 2 });
+
+            if(curr.node->right != nullptr)
+                stack.push_back({ curr.node->right, curr.level + 1, curr.offset * 2 + 1 });
         }
     }
 
     //---------------------------
 
+    void removeItem(const Key& key) {
+
+        typename ItemsByKey::iterator it = m_itemsByKey.find(key);
+        if(it == m_itemsByKey.end())
+            return;
+
+        TreeRenderedItem<Key>* item = it->second;
+        m_itemsByKey.erase(it);
+
+        if(item == m_selectedItem)
+            m_selectedItem = nullptr;
+
+        --m_levelCounts[item->level];
+
+        // Draw order does not matter, the last item fills the hole
+        m_items[item->index] = m_items.back();
+        m_items[item->index]->index = item->index;
+        m_items.pop_back();
+
+        m_cellsChanged = true;
+
+        delete item;
+    }
+
+    //---------------------------
+
     void setupHelpScreenBounds() {
 
         if(m_state == State::TreeView) {
@@ -601,6 +906,18 @@ private:
 
     //---------------------------
 
+    // Bottom left corner, clear of the help square
+    void setupStatsSignBounds() {
+
+        float margin = std::max(m_size.x * 0.1f, m_size.y * 0.1f) * 0.25f;
+
+        m_statsSign.setPosition(margin, m_size.y - margin);
+        m_statsSign.setOrigin(m_statsSign.getLocalBounds().left,
+                              m_statsSign.getLocalBounds().height + m_statsSign.getLocalBounds().top);
+    }
+
+    //---------------------------
+
     void setupAddItemPrintingText() {
 
         if(m_state == State::AddItemKey)
@@ -631,40 +948,43 @@ private:
         states.transform.combine(this->getTransform());
         target.draw(m_background, 4, sf::PrimitiveType::TriangleFan, states);
 
-        for(size_t i = 0; i < m_items.size(); ++i) {
+        if(m_cellsChanged)
+            this->packCells();
 
-            sf::Color c = m_items[i]->vertices[0].color;
+        target.draw(m_cells, states);
 
-            if(m_items[i] == m_selectedItem) {
-
-                float s  = std::abs(std::cos(m_animClock.getElapsedTime().asSeconds())) * 0.7f + 0.3f,
-                      is = 1.0f - s;
+        // The blinking selection goes over its cell, the packed cells stay as they are
+        if(m_selectedItem != nullptr) {
 
-                sf::Color c2 = c;
-                c2.r = static_cast<unsigned char>(std::min(0   * s + c.r * is, 255.0f));
-                c2.g = static_cast<unsigned char>(std::min(170 * s + c.g * is, 255.0f));
-                c2.b = static_cast<unsigned char>(std::min(255 * s + c.b * is, 255.0f));
+            const sf::Color& c = m_selectedItem->vertices[0].color;
 
-                m_items[i]->vertices[0].color = c2;
-                m_items[i]->vertices[1].color = c2;
-                m_items[i]->vertices[2].color = c2;
-                m_items[i]->vertices[3].color = c2;
-            }
+            float s  = std::abs(std::cos(m_animClock.getElapsedTime().asSeconds())) * 0.7f + 0.3f,
+                  is = 1.0f - s;
 
-            target.draw(*m_items[i], states);
+            sf::Color c2 = c;
+            c2.r = static_cast<unsigned char>(std::min(0   * s + c.r * is, 255.0f));
+            c2.g = static_cast<unsigned char>(std::min(170 * s + c.g * is, 255.0f));
+            c2.b = static_cast<unsigned char>(std::min(255 * s + c.b * is, 255.0f));
 
-            if(m_items[i] == m_selectedItem) {
+            sf::Vertex selected[4];
 
-                m_items[i]->vertices[0].color = c;
-                m_items[i]->vertices[1].color = c;
-                m_items[i]->vertices[2].color = c;
-                m_items[i]->vertices[3].color = c;
+            for(int v = 0; v < 4; ++v) {
+                selected[v].position = m_selectedItem->vertices[v].position;
+                selected[v].color = c2;
             }
+
+            target.draw(selected, 4, sf::PrimitiveType::TriangleFan, states);
         }
 
+        for(size_t i = 0; i < m_items.size(); ++i)
+            target.draw(m_items[i]->sign, states);
+
         target.draw(m_helpScreen, 4, sf::PrimitiveType::TriangleFan);
         target.draw(m_sign, states);
 
+        if(m_showStats && m_state == State::TreeView)
+            target.draw(m_statsSign, states);
+
         if(m_state != State::TreeView)
             target.draw(m_helpScreenSign, states);
 
@@ -11,9 +11,31 @@
 
 //---------------------------
 
+// Patches the view from the change log of the map, rebuilds it after a bulk operation
+template <class TMap>
+void updateRenderer(TreeRenderer<int, char>& renderer, TMap& map, TreeLayout<int, char>& layout) {
+
+    if(!renderer.applyChanges(map.getChanges())) {
+        map.exportLayout(layout);
+        renderer.buildFromLayout(layout);
+    }
+
+    map.clearChanges();
+    renderer.setStatsSign(map.stats().toString());
+}
+
+//---------------------------
+
 int main() {
 
-    Map<int, char> map;
+    // Counters on, for the T overlay
+    Map<int, char, NodePool<Node<int, char>>, true, true> map;
+
+    // Removals follow the WASD selection, which stays close to the last touched key
+    map.setFingerSearch(true);
+
+    // The renderer patches itself from the change log after an edit instead of rebuilding
+    map.setChangeLog(true);
 
     map.add(1, 'a');
     map.add(2, 'b');
@@ -58,7 +80,8 @@ int main() {
 
     IDENT_PRINT;
 
-    std::vector<DataS<int, char>> buff = map.getTree();
+    TreeLayout<int, char> layout;
+    map.exportLayout(layout);
 
     std::cout << "Enter to continue for render tree\n";
     getchar();
@@ -79,7 +102,9 @@ int main() {
     TreeRenderer<int, char> renderer;
     renderer.setSize(640, 480);
     renderer.setFont(font);
-    renderer.buildFromVector(buff);
+    renderer.buildFromLayout(layout);
+    renderer.setStatsSign(map.stats().toString());
+    map.clearChanges();
     renderer.activate();
 
     while(window.isOpen()) {
@@ -100,7 +125,7 @@ int main() {
                     else if(event.key.code == sf::Keyboard::Enter) {
                         renderer.finishNewItemEdit();
                         map.add(renderer.getPendingItem());
-                        renderer.buildFromVector(map.getTree());
+                        updateRenderer(renderer, map, layout);
                     }
 
                 } else if(renderer.isFindingState()) {
@@ -135,8 +160,11 @@ int main() {
 
                     else if(event.key.code == sf::Keyboard::Q) {
                         map.remove(renderer.getSelectedItemKey());
-                        renderer.buildFromVector(map.getTree());
+                        updateRenderer(renderer, map, layout);
                     }
+
+                    else if(event.key.code == sf::Keyboard::T)
+                        renderer.toggleStats();
 
                     else if(event.key.code == sf::Keyboard::F1) {
                         system("cls");